@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_batch.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_preprocessor.hpp"
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <algorithm> // std::min
+
+namespace
+{
+	/// <summary>
+	/// A double-ended queue of job indices per worker thread. The owning thread takes work from the front, while idle threads steal from the back.
+	/// </summary>
+	class work_queue
+	{
+	public:
+		void push(size_t index)
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+			_items.push_back(index);
+		}
+
+		bool pop(size_t &index)
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+			if (_items.empty())
+				return false;
+			index = _items.front();
+			_items.pop_front();
+			return true;
+		}
+		bool steal(size_t &index)
+		{
+			const std::lock_guard<std::mutex> lock(_mutex);
+			if (_items.empty())
+				return false;
+			index = _items.back();
+			_items.pop_back();
+			return true;
+		}
+
+	private:
+		std::mutex _mutex;
+		std::deque<size_t> _items;
+	};
+}
+
+static void execute_compile_job(const reshadefx::compile_job &job, reshadefx::include_cache &cache, reshadefx::compile_result &result)
+{
+	reshadefx::preprocessor pp;
+	pp.set_include_cache(&cache);
+	for (const std::filesystem::path &include_path : job.include_paths)
+		pp.add_include_path(include_path);
+	for (const auto &[name, value] : job.macros)
+		pp.add_macro_definition(name, value);
+
+	if (!pp.append_file(job.path))
+	{
+		result.errors = pp.errors();
+		return;
+	}
+
+	const reshadefx::backend_options &options = job.backend;
+
+	std::unique_ptr<reshadefx::codegen> backend;
+	switch (options.type)
+	{
+	case reshadefx::backend_type::spirv:
+		backend.reset(reshadefx::create_codegen_spirv(options.vulkan_semantics, options.debug_info, options.uniforms_to_spec_constants, options.enable_16bit_types, options.flip_vert_y));
+		break;
+	case reshadefx::backend_type::hlsl:
+		backend.reset(reshadefx::create_codegen_hlsl(options.shader_model, options.debug_info, options.uniforms_to_spec_constants));
+		break;
+	case reshadefx::backend_type::glsl:
+		backend.reset(reshadefx::create_codegen_glsl(options.debug_info, options.uniforms_to_spec_constants, options.enable_16bit_types, options.flip_vert_y));
+		break;
+	}
+
+	reshadefx::parser parser;
+	result.success = parser.parse(pp.output(), pp.output_source_map(), backend.get());
+	result.errors = pp.errors() + parser.errors();
+
+	if (result.success)
+		backend->write_result(result.module);
+}
+
+std::vector<reshadefx::compile_result> reshadefx::compile_batch(const std::vector<compile_job> &jobs, unsigned int num_threads)
+{
+	std::vector<compile_result> results(jobs.size());
+	if (jobs.empty())
+		return results;
+
+	if (num_threads == 0)
+		num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	num_threads = static_cast<unsigned int>(std::min<size_t>(num_threads, jobs.size()));
+
+	include_cache cache;
+
+	// Distribute jobs evenly across all workers up front, so that stealing is only needed to balance out differences in job cost
+	std::vector<work_queue> queues(num_threads);
+	for (size_t i = 0; i < jobs.size(); ++i)
+		queues[i % num_threads].push(i);
+
+	const auto worker = [&](unsigned int worker_index) {
+		for (size_t index;;)
+		{
+			if (!queues[worker_index].pop(index))
+			{
+				// Own queue is empty, so try to take work from the other workers
+				// No new jobs are added once started, so can stop as soon as all queues were found empty
+				bool found = false;
+				for (unsigned int i = 1; i < num_threads && !found; ++i)
+					found = queues[(worker_index + i) % num_threads].steal(index);
+				if (!found)
+					break;
+			}
+
+			execute_compile_job(jobs[index], cache, results[index]);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(num_threads - 1);
+	for (unsigned int i = 1; i < num_threads; ++i)
+		threads.emplace_back(worker, i);
+
+	// Calling thread participates as the first worker
+	worker(0);
+
+	for (std::thread &thread : threads)
+		thread.join();
+
+	return results;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <filesystem>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// A list of code generation back-ends.
+	/// </summary>
+	enum class backend_type
+	{
+		spirv,
+		hlsl,
+		glsl,
+	};
+
+	/// <summary>
+	/// Selects the code generation back-end and its options for a compile job (see 'create_codegen_spirv', 'create_codegen_hlsl' and 'create_codegen_glsl').
+	/// </summary>
+	struct backend_options
+	{
+		backend_type type = backend_type::spirv;
+		unsigned int shader_model = 50; // HLSL shader model version (only applies to HLSL)
+		bool vulkan_semantics = true; // Generate SPIR-V for Vulkan instead of OpenGL (only applies to SPIR-V)
+		bool debug_info = false;
+		bool uniforms_to_spec_constants = false;
+		bool enable_16bit_types = false; // Does not apply to HLSL
+		bool flip_vert_y = false; // Does not apply to HLSL
+	};
+
+	/// <summary>
+	/// Describes a single effect file to compile as part of a batch.
+	/// </summary>
+	struct compile_job
+	{
+		std::filesystem::path path;
+		std::vector<std::filesystem::path> include_paths;
+		std::vector<std::pair<std::string, std::string>> macros; // Macro definitions (name and value), added in order before the file is pre-processed
+		backend_options backend;
+	};
+
+	/// <summary>
+	/// The result of a single compile job.
+	/// </summary>
+	struct compile_result
+	{
+		bool success = false;
+		std::string errors; // Errors and warnings of the preprocessor and the parser
+		reshadefx::module module;
+	};
+
+	/// <summary>
+	/// Compile a list of effect files in parallel on a work-stealing thread pool.
+	/// Every job uses its own preprocessor, parser and code generator, only included files are shared between jobs through a common <see cref="include_cache"/>.
+	/// The results do not depend on the number of threads or the order in which jobs are executed.
+	/// </summary>
+	/// <param name="jobs">The list of jobs to compile.</param>
+	/// <param name="num_threads">The number of threads to use (including the calling thread), or zero to use one per hardware thread.</param>
+	/// <returns>A result for every job, in the same order as the input list.</returns>
+	std::vector<compile_result> compile_batch(const std::vector<compile_job> &jobs, unsigned int num_threads = 0);
+}
@@ -7,6 +7,7 @@
 
 #include "effect_module.hpp"
 #include <memory> // std::unique_ptr
+#include <memory_resource> // std::pmr::monotonic_buffer_resource
 #include <algorithm> // std::find_if
 
 namespace reshadefx
@@ -28,6 +29,18 @@ namespace reshadefx
 		/// <param name="module">The target module to fill.</param>
 		virtual void write_result(module &module) = 0;
 
+		/// <summary>
+		/// Set the table used to resolve the source file names of code locations passed to this code generator.
+		/// </summary>
+		/// <param name="sources">The source table of the current compilation.</param>
+		void set_source_table(const source_table *sources) { _sources = sources; }
+
+		/// <summary>
+		/// Get the memory resource for short-lived allocations during a single compile with this code generator (argument lists, name tables, ...).
+		/// Memory allocated from it is not freed individually, but all at once when the code generator is destroyed after <see cref="write_result"/>.
+		/// </summary>
+		std::pmr::memory_resource *arena() { return &_arena; }
+
 	public:
 		/// <summary>
 		/// An opaque ID referring to a SSA value or basic block.
@@ -170,7 +183,7 @@ namespace reshadefx
 		/// <param name="res_type">The data type of the call result.</param>
 		/// <param name="args">A list of SSA IDs representing the call arguments.</param>
 		/// <returns>New SSA ID with the result of the function call.</returns>
-		virtual id emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) = 0;
+		virtual id emit_call(const location &loc, id function, const type &res_type, const std::pmr::vector<expression> &args) = 0;
 		/// <summary>
 		/// Add an intrinsic function call to the output.
 		/// </summary>
@@ -179,14 +192,14 @@ namespace reshadefx
 		/// <param name="res_type">The data type of the call result.</param>
 		/// <param name="args">A list of SSA IDs representing the call arguments.</param>
 		/// <returns>New SSA ID with the result of the function call.</returns>
-		virtual id emit_call_intrinsic(const location &loc, id function, const type &res_type, const std::vector<expression> &args) = 0;
+		virtual id emit_call_intrinsic(const location &loc, id function, const type &res_type, const std::pmr::vector<expression> &args) = 0;
 		/// <summary>
 		/// Add a type constructor call to the output.
 		/// </summary>
 		/// <param name="type">The data type to construct.</param>
 		/// <param name="args">A list of SSA IDs representing the scalar constructor arguments.</param>
 		/// <returns>New SSA ID with the constructed value.</returns>
-		virtual id emit_construct(const location &loc, const type &type, const std::vector<expression> &args) = 0;
+		virtual id emit_construct(const location &loc, const type &type, const std::pmr::vector<expression> &args) = 0;
 
 		/// <summary>
 		/// Add a structured branch control flow to the output.
@@ -329,7 +342,9 @@ namespace reshadefx
 			return align_up(size, alignment) * (elements - 1) + size;
 		}
 
+		std::pmr::monotonic_buffer_resource _arena; // Declared first, so that it outlives all other members
 		reshadefx::module _module;
+		const source_table *_sources = nullptr;
 		std::vector<struct_info> _structs;
 		std::vector<std::unique_ptr<function_info>> _functions;
 		id _next_id = 1;
@@ -353,6 +368,25 @@ namespace reshadefx
 	/// <param name="uniforms_to_spec_constants">Whether to convert uniform variables to specialization constants.</param>
 	codegen *create_codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants);
 	/// <summary>
+	/// A back-end interface that records all code generation calls into a compact intermediate representation, instead of generating code itself.
+	/// </summary>
+	class codegen_recorder : public codegen
+	{
+	public:
+		/// <summary>
+		/// Write the recorded calls to the specified <paramref name="ir"/> list of 32-bit words. This may only be called once, after parsing finished.
+		/// </summary>
+		/// <param name="ir">The target word list to fill.</param>
+		virtual void write_recording(std::vector<uint32_t> &ir) = 0;
+	};
+
+	/// <summary>
+	/// Create a back-end implementation that records all code generation calls into a compact intermediate representation, instead of generating code itself.
+	/// This allows parsing an effect only once and then generating code for any number of other back-ends from the recording (see <see cref="replay_codegen_ir"/>).
+	/// Use <see cref="codegen_recorder::write_recording"/> to get the recording, <see cref="codegen::write_result"/> leaves the module empty.
+	/// </summary>
+	codegen_recorder *create_codegen_ir();
+	/// <summary>
 	/// Create a back-end implementation for SPIR-V code generation.
 	/// </summary>
 	/// <param name="vulkan_semantics">Generate SPIR-V for OpenGL or for Vulkan.</param>
@@ -361,4 +395,14 @@ namespace reshadefx
 	/// <param name="enable_16bit_types">Use real 16-bit types for the minimum precision types "min16int", "min16uint" and "min16float".</param>
 	/// <param name="flip_vert_y">Insert code to flip the Y component of the output position in vertex shaders.</param>
 	codegen *create_codegen_spirv(bool vulkan_semantics, bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types = false, bool flip_vert_y = false);
+
+	/// <summary>
+	/// Replay a recording made with the back-end created by <see cref="create_codegen_ir"/> into another back-end.
+	/// Afterwards the back-end is in the same state as if the effect was parsed with it directly, so call <see cref="codegen::write_result"/> on it to get the generated module.
+	/// The recording is not modified, so it can be replayed into multiple back-ends concurrently.
+	/// </summary>
+	/// <param name="ir">The recording to replay.</param>
+	/// <param name="backend">The back-end to replay the recorded calls into. This should be a newly created back-end that was not used for anything else yet.</param>
+	/// <returns><see langword="true"/> if the recording was replayed successfully, <see langword="false"/> if it is malformed.</returns>
+	bool replay_codegen_ir(const std::vector<uint32_t> &ir, codegen *backend);
 }
@@ -5,6 +5,7 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_text.hpp"
 #include <cmath> // signbit, isinf, isnan
 #include <cstdio> // snprintf
 #include <cassert>
@@ -39,8 +40,8 @@ private:
 
 	std::string _ubo_block;
 	std::string _compute_block;
-	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	std::pmr::unordered_map<id, std::string> _names { arena() };
+	std::pmr::unordered_map<id, std::string> _blocks { arena() };
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	bool _enable_16bit_types = false;
@@ -94,7 +95,7 @@ private:
 		if (!_ubo_block.empty())
 			// Read matrices in column major layout, even though they are actually row major, to avoid transposing them on every access (since GLSL uses column matrices)
 			// TODO: This technically only works with square matrices
-			module.hlsl += "layout(std140, column_major, binding = 0) uniform _Globals {\n" + _ubo_block + "};\n";
+			append_text(module.hlsl, "layout(std140, column_major, binding = 0) uniform _Globals {\n", _ubo_block, "};\n");
 		module.hlsl += _blocks.at(0);
 	}
 
@@ -139,9 +140,9 @@ private:
 			break;
 		case type::t_bool:
 			if (type.cols > 1)
-				s += "mat" + std::to_string(type.rows) + 'x' + std::to_string(type.cols);
+				append_text(s, "mat", type.rows, 'x', type.cols);
 			else if (type.rows > 1)
-				s += "bvec" + std::to_string(type.rows);
+				append_text(s, "bvec", type.rows);
 			else
 				s += "bool";
 			break;
@@ -150,7 +151,7 @@ private:
 			{
 				assert(type.cols == 1);
 				if (type.rows > 1)
-					s += "i16vec" + std::to_string(type.rows);
+					append_text(s, "i16vec", type.rows);
 				else
 					s += "int16_t";
 				break;
@@ -160,9 +161,9 @@ private:
 			// fall through
 		case type::t_int:
 			if (type.cols > 1)
-				s += "mat" + std::to_string(type.rows) + 'x' + std::to_string(type.cols);
+				append_text(s, "mat", type.rows, 'x', type.cols);
 			else if (type.rows > 1)
-				s += "ivec" + std::to_string(type.rows);
+				append_text(s, "ivec", type.rows);
 			else
 				s += "int";
 			break;
@@ -171,7 +172,7 @@ private:
 			{
 				assert(type.cols == 1);
 				if (type.rows > 1)
-					s += "u16vec" + std::to_string(type.rows);
+					append_text(s, "u16vec", type.rows);
 				else
 					s += "uint16_t";
 				break;
@@ -181,9 +182,9 @@ private:
 			// fall through
 		case type::t_uint:
 			if (type.cols > 1)
-				s += "mat" + std::to_string(type.rows) + 'x' + std::to_string(type.cols);
+				append_text(s, "mat", type.rows, 'x', type.cols);
 			else if (type.rows > 1)
-				s += "uvec" + std::to_string(type.rows);
+				append_text(s, "uvec", type.rows);
 			else
 				s += "uint";
 			break;
@@ -192,7 +193,7 @@ private:
 			{
 				assert(type.cols == 1);
 				if (type.rows > 1)
-					s += "f16vec" + std::to_string(type.rows);
+					append_text(s, "f16vec", type.rows);
 				else
 					s += "float16_t";
 				break;
@@ -202,9 +203,9 @@ private:
 			// fall through
 		case type::t_float:
 			if (type.cols > 1)
-				s += "mat" + std::to_string(type.rows) + 'x' + std::to_string(type.cols);
+				append_text(s, "mat", type.rows, 'x', type.cols);
 			else if (type.rows > 1)
-				s += "vec" + std::to_string(type.rows);
+				append_text(s, "vec", type.rows);
 			else
 				s += "float";
 			break;
@@ -229,11 +230,11 @@ private:
 			elem_type.array_length = 0;
 
 			write_type<false, false>(s, elem_type);
-			s += '[' + std::to_string(type.array_length) + "](";
+			append_text(s, '[', type.array_length, "](");
 
 			for (int i = 0; i < type.array_length; ++i)
 			{
-				write_constant(s, elem_type, i < static_cast<int>(data.array_data.size()) ? data.array_data[i] : constant());
+				write_constant(s, elem_type, i < static_cast<int>(data.array_data->size()) ? (*data.array_data)[i] : constant());
 
 				if (i < type.array_length - 1)
 					s += ", ";
@@ -258,11 +259,11 @@ private:
 				break;
 			case type::t_min16int:
 			case type::t_int:
-				s += std::to_string(data.as_int[i]);
+				append_text(s, data.as_int[i]);
 				break;
 			case type::t_min16uint:
 			case type::t_uint:
-				s += std::to_string(data.as_uint[i]) + 'u';
+				append_text(s, data.as_uint[i], 'u');
 				break;
 			case type::t_min16float:
 			case type::t_float:
@@ -291,10 +292,10 @@ private:
 	}
 	void write_location(std::string &s, const location &loc) const
 	{
-		if (loc.source.empty() || !_debug_info)
+		if (loc.source_id == 0 || !_debug_info)
 			return;
 
-		s += "#line " + std::to_string(loc.line) + '\n';
+		append_text(s, "#line ", loc.line, '\n');
 	}
 
 	std::string id_to_name(id id) const
@@ -318,7 +319,7 @@ private:
 			name = escape_name(std::move(name));
 		if constexpr (naming_type == naming::general)
 			if (std::find_if(_names.begin(), _names.end(), [&name](const auto &it) { return it.second == name; }) != _names.end())
-				name += '_' + std::to_string(id); // Append a numbered suffix if the name already exists
+				append_text(name, '_', id); // Append a numbered suffix if the name already exists
 		_names[id] = std::move(name);
 	}
 
@@ -435,7 +436,7 @@ private:
 
 		write_location(code, loc);
 
-		code += "struct " + id_to_name(info.definition) + "\n{\n";
+		append_text(code, "struct ", id_to_name(info.definition), "\n{\n");
 
 		for (const auto &member : info.member_list)
 		{
@@ -444,7 +445,7 @@ private:
 			code += ' ';
 			code += escape_name(member.name);
 			if (member.type.is_array())
-				code += '[' + std::to_string(member.type.array_length) + ']';
+				append_text(code, '[', member.type.array_length, ']');
 			code += ";\n";
 		}
 
@@ -476,7 +477,7 @@ private:
 
 		write_location(code, loc);
 
-		code += "layout(binding = " + std::to_string(info.binding) + ") uniform sampler2D " + id_to_name(info.id) + ";\n";
+		append_text(code, "layout(binding = ", info.binding, ") uniform sampler2D ", id_to_name(info.id), ";\n");
 
 		_module.samplers.push_back(info);
 
@@ -493,7 +494,7 @@ private:
 
 		write_location(code, loc);
 
-		code += "layout(binding = " + std::to_string(info.binding) + ") uniform writeonly image2D " + id_to_name(info.id) + ";\n";
+		append_text(code, "layout(binding = ", info.binding, ") uniform writeonly image2D ", id_to_name(info.id), ";\n");
 
 		_module.storages.push_back(info);
 
@@ -517,10 +518,10 @@ private:
 
 			code += "const ";
 			write_type(code, info.type);
-			code += ' ' + id_to_name(res) + " = ";
+			append_text(code, ' ', id_to_name(res), " = ");
 			if (!info.type.is_scalar())
 				write_type<false, false>(code, info.type);
-			code += "(SPEC_CONSTANT_" + info.name + ");\n";
+			append_text(code, "(SPEC_CONSTANT_", info.name, ");\n");
 
 			_module.spec_constants.push_back(info);
 		}
@@ -558,10 +559,10 @@ private:
 			_ubo_block += '\t';
 			// Note: All matrices are floating-point, even if the uniform type says different!!
 			write_type(_ubo_block, info.type);
-			_ubo_block += ' ' + id_to_name(res);
+			append_text(_ubo_block, ' ', id_to_name(res));
 
 			if (info.type.is_array())
-				_ubo_block += '[' + std::to_string(info.type.array_length) + ']';
+				append_text(_ubo_block, '[', info.type.array_length, ']');
 
 			_ubo_block += ";\n";
 
@@ -589,13 +590,13 @@ private:
 			code += '\t';
 
 		write_type(code, type);
-		code += ' ' + id_to_name(res);
+		append_text(code, ' ', id_to_name(res));
 
 		if (type.is_array())
-			code += '[' + std::to_string(type.array_length) + ']';
+			append_text(code, '[', type.array_length, ']');
 
 		if (initializer_value != 0)
-			code += " = " + id_to_name(initializer_value);
+			append_text(code, " = ", id_to_name(initializer_value));
 
 		code += ";\n";
 
@@ -623,7 +624,7 @@ private:
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
-		code += ' ' + id_to_name(info.definition) + '(';
+		append_text(code, ' ', id_to_name(info.definition), '(');
 
 		assert(info.parameter_list.empty() || !is_entry_point);
 
@@ -638,10 +639,10 @@ private:
 			write_location(code, param.location);
 			code += '\t';
 			write_type<true>(code, param.type); // GLSL does not allow interpolation attributes on function parameters
-			code += ' ' + id_to_name(param.definition);
+			append_text(code, ' ', id_to_name(param.definition));
 
 			if (param.type.is_array())
-				code += '[' + std::to_string(param.type.array_length) + ']';
+				append_text(code, '[', param.type.array_length, ']');
 
 			if (i < num_params - 1)
 				code += ',';
@@ -669,7 +670,7 @@ private:
 
 		_module.entry_points.push_back({ func.unique_name, stype });
 
-		_blocks.at(0) += "#ifdef ENTRY_POINT_" + func.unique_name + '\n';
+		append_text(_blocks.at(0), "#ifdef ENTRY_POINT_", func.unique_name, '\n');
 		if (stype == shader_type::cs)
 			_blocks.at(0) += "layout(local_size_x = " + std::to_string(num_threads[0]) +
 			                      ", local_size_y = " + std::to_string(num_threads[1]) +
@@ -703,7 +704,7 @@ private:
 
 			for (int a = 0; a < array_length; ++a)
 			{
-				code += "layout(location = " + std::to_string(location + a) + ") ";
+				append_text(code, "layout(location = ", location + a, ") ");
 				write_type<false, false, true>(code, type);
 				code += ' ';
 				code += escape_name(type.is_array() ?
@@ -859,7 +860,7 @@ private:
 			code += ' ';
 			code += escape_name("_param" + std::to_string(i));
 			if (param_type.is_array())
-				code += '[' + std::to_string(param_type.array_length) + ']';
+				append_text(code, '[', param_type.array_length, ']');
 
 			// Initialize those local variables with the input value if existing
 			// Parameters with only an "out" qualifier are written to by the entry point function, so do not need to be initialized
@@ -907,11 +908,11 @@ private:
 		}
 
 		// Call the function this entry point refers to
-		code += id_to_name(func.definition) + '(';
+		append_text(code, id_to_name(func.definition), '(');
 
 		for (size_t i = 0; i < num_params; ++i)
 		{
-			code += "_param" + std::to_string(i);
+			append_text(code, "_param", i);
 
 			if (i < num_params - 1)
 				code += ", ";
@@ -944,10 +945,10 @@ private:
 								code += " = ";
 								code += escape_name("_param" + std::to_string(i));
 								if (param_type.is_array())
-									code += '[' + std::to_string(a) + ']';
+									append_text(code, '[', a, ']');
 								code += '.';
 								code += member.name;
-								code += '[' + std::to_string(b) + ']';
+								append_text(code, '[', b, ']');
 								code += ";\n";
 							}
 						}
@@ -958,7 +959,7 @@ private:
 							code += " = ";
 							code += escape_name("_param" + std::to_string(i));
 							if (param_type.is_array())
-								code += '[' + std::to_string(a) + ']';
+								append_text(code, '[', a, ']');
 							code += '.';
 							code += member.name;
 							code += ";\n";
@@ -977,7 +978,7 @@ private:
 						code += escape_name("_out_param" + std::to_string(i) + '_' + std::to_string(a));
 						code += " = ";
 						code += escape_name("_param" + std::to_string(i));
-						code += '[' + std::to_string(a) + ']';
+						append_text(code, '[', a, ']');
 						code += ";\n";
 					}
 				}
@@ -1001,7 +1002,7 @@ private:
 			{
 				code += '\t';
 				code += semantic_to_builtin("_return_" + member.name, member.semantic, stype);
-				code += " = _return." + escape_name(member.name) + ";\n";
+				append_text(code, " = _return.", escape_name(member.name), ";\n");
 			}
 		}
 
@@ -1042,14 +1043,14 @@ private:
 			case expression::operation::op_dynamic_index:
 				// For matrices this will extract a column, but that is fine, since they are initialized column-wise too
 				// Also cast to an integer, since it could be a boolean too, but GLSL does not allow those in index expressions
-				expr_code += "[int(" + id_to_name(op.index) + ")]";
+				append_text(expr_code, "[int(", id_to_name(op.index), ")]");
 				break;
 			case expression::operation::op_constant_index:
 				if (op.from.is_vector() && !op.from.is_array())
 					expr_code += '.',
 					expr_code += "xyzw"[op.index];
 				else
-					expr_code += '[' + std::to_string(op.index) + ']';
+					append_text(expr_code, '[', op.index, ']');
 				break;
 			case expression::operation::op_swizzle:
 				if (op.from.is_matrix())
@@ -1059,7 +1060,7 @@ private:
 						const int row = (op.swizzle[0] % 4);
 						const int col = (op.swizzle[0] - row) / 4;
 
-						expr_code += '[' + std::to_string(row) + "][" + std::to_string(col) + ']';
+						append_text(expr_code, '[', row, "][", col, ']');
 					}
 					else
 					{
@@ -1093,7 +1094,7 @@ private:
 
 			code += '\t';
 			write_type(code, exp.type);
-			code += ' ' + id_to_name(res) + " = " + expr_code + ";\n";
+			append_text(code, ' ', id_to_name(res), " = ", expr_code, ";\n");
 		}
 		else
 		{
@@ -1117,7 +1118,7 @@ private:
 
 		write_location(code, exp.location);
 
-		code += '\t' + id_to_name(exp.base);
+		append_text(code, '\t', id_to_name(exp.base));
 
 		for (const auto &op : exp.chain)
 		{
@@ -1128,10 +1129,10 @@ private:
 				code += escape_name(find_struct(op.from.definition).member_list[op.index].name);
 				break;
 			case expression::operation::op_dynamic_index:
-				code += "[int(" + id_to_name(op.index) + ")]";
+				append_text(code, "[int(", id_to_name(op.index), ")]");
 				break;
 			case expression::operation::op_constant_index:
-				code += '[' + std::to_string(op.index) + ']';
+				append_text(code, '[', op.index, ']');
 				break;
 			case expression::operation::op_swizzle:
 				if (op.from.is_matrix())
@@ -1141,7 +1142,7 @@ private:
 						const int row = (op.swizzle[0] % 4);
 						const int col = (op.swizzle[0] - row) / 4;
 
-						code += '[' + std::to_string(row) + "][" + std::to_string(col) + ']';
+						append_text(code, '[', row, "][", col, ']');
 					}
 					else
 					{
@@ -1165,9 +1166,9 @@ private:
 		// GLSL matrices are always floating point, so need to cast type
 		if (!exp.chain.empty() && exp.chain[0].from.is_matrix() && !exp.chain[0].from.is_floating_point())
 			// Only supporting scalar assignments to matrices currently, so can assume to always cast to float
-			code += "float(" + id_to_name(value) + ");\n";
+			append_text(code, "float(", id_to_name(value), ");\n");
 		else
-			code += id_to_name(value) + ";\n";
+			append_text(code, id_to_name(value), ";\n");
 	}
 
 	id   emit_constant(const type &type, const constant &data) override
@@ -1185,11 +1186,11 @@ private:
 				code += "const ";
 
 			write_type(code, type);
-			code += ' ' + id_to_name(res);
+			append_text(code, ' ', id_to_name(res));
 
 			// Array constants need to be stored in a constant variable as they cannot be used in-place
 			if (type.is_array())
-				code += '[' + std::to_string(type.array_length) + ']';
+				append_text(code, '[', type.array_length, ']');
 
 			// Struct initialization is not supported right now
 			if (!type.is_struct()) {
@@ -1218,7 +1219,7 @@ private:
 
 		code += '\t';
 		write_type(code, res_type);
-		code += ' ' + id_to_name(res) + " = ";
+		append_text(code, ' ', id_to_name(res), " = ");
 
 		switch (op)
 		{
@@ -1238,7 +1239,7 @@ private:
 			assert(false);
 		}
 
-		code += '(' + id_to_name(val) + ");\n";
+		append_text(code, '(', id_to_name(val), ");\n");
 
 		return res;
 	}
@@ -1252,7 +1253,7 @@ private:
 
 		code += '\t';
 		write_type(code, res_type);
-		code += ' ' + id_to_name(res) + " = ";
+		append_text(code, ' ', id_to_name(res), " = ");
 
 		std::string intrinsic, operator_code;
 
@@ -1362,9 +1363,9 @@ private:
 		}
 
 		if (!intrinsic.empty())
-			code += intrinsic + '(' + id_to_name(lhs) + ", " + id_to_name(rhs) + ')';
+			append_text(code, intrinsic, '(', id_to_name(lhs), ", ", id_to_name(rhs), ')');
 		else
-			code += id_to_name(lhs) + ' ' + operator_code + ' ' + id_to_name(rhs);
+			append_text(code, id_to_name(lhs), ' ', operator_code, ' ', id_to_name(rhs));
 
 		code += ";\n";
 
@@ -1383,10 +1384,10 @@ private:
 
 		code += '\t';
 		write_type(code, res_type);
-		code += ' ' + id_to_name(res);
+		append_text(code, ' ', id_to_name(res));
 
 		if (res_type.is_array())
-			code += '[' + std::to_string(res_type.array_length) + ']';
+			append_text(code, '[', res_type.array_length, ']');
 
 		code += " = ";
 
@@ -1394,11 +1395,11 @@ private:
 			code += "compCond(" + id_to_name(condition) + ", " + id_to_name(true_value) + ", " + id_to_name(false_value) + ");\n",
 			_uses_componentwise_cond = true;
 		else // GLSL requires the conditional expression to be a scalar boolean
-			code += id_to_name(condition) + " ? " + id_to_name(true_value) + " : " + id_to_name(false_value) + ";\n";
+			append_text(code, id_to_name(condition), " ? ", id_to_name(true_value), " : ", id_to_name(false_value), ";\n");
 
 		return res;
 	}
-	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call(const location &loc, id function, const type &res_type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1416,15 +1417,15 @@ private:
 		if (!res_type.is_void())
 		{
 			write_type(code, res_type);
-			code += ' ' + id_to_name(res);
+			append_text(code, ' ', id_to_name(res));
 
 			if (res_type.is_array())
-				code += '[' + std::to_string(res_type.array_length) + ']';
+				append_text(code, '[', res_type.array_length, ']');
 
 			code += " = ";
 		}
 
-		code += id_to_name(function) + '(';
+		append_text(code, id_to_name(function), '(');
 
 		for (size_t i = 0, num_args = args.size(); i < num_args; ++i)
 		{
@@ -1438,7 +1439,7 @@ private:
 
 		return res;
 	}
-	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1456,7 +1457,7 @@ private:
 		if (!res_type.is_void())
 		{
 			write_type(code, res_type);
-			code += ' ' + id_to_name(res) + " = ";
+			append_text(code, ' ', id_to_name(res), " = ");
 		}
 
 		enum
@@ -1477,7 +1478,7 @@ private:
 
 		return res;
 	}
-	id   emit_construct(const location &loc, const type &type, const std::vector<expression> &args) override
+	id   emit_construct(const location &loc, const type &type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const auto &arg : args)
@@ -1492,17 +1493,17 @@ private:
 
 		code += '\t';
 		write_type(code, type);
-		code += ' ' + id_to_name(res);
+		append_text(code, ' ', id_to_name(res));
 
 		if (type.is_array())
-			code += '[' + std::to_string(type.array_length) + ']';
+			append_text(code, '[', type.array_length, ']');
 
 		code += " = ";
 
 		write_type<false, false>(code, type);
 
 		if (type.is_array())
-			code += '[' + std::to_string(type.array_length) + ']';
+			append_text(code, '[', type.array_length, ']');
 
 		code += '(';
 
@@ -1535,7 +1536,7 @@ private:
 
 		write_location(code, loc);
 
-		code += "\tif (" + id_to_name(condition_value) + ")\n\t{\n";
+		append_text(code, "\tif (", id_to_name(condition_value), ")\n\t{\n");
 		code += true_statement_data;
 		code += "\t}\n";
 
@@ -1569,16 +1570,16 @@ private:
 
 		code += '\t';
 		write_type(code, type);
-		code += ' ' + id_to_name(res) + ";\n";
+		append_text(code, ' ', id_to_name(res), ";\n");
 
 		write_location(code, loc);
 
-		code += "\tif (" + id_to_name(condition_value) + ")\n\t{\n";
+		append_text(code, "\tif (", id_to_name(condition_value), ")\n\t{\n");
 		code += (true_statement_block != condition_block ? true_statement_data : std::string());
-		code += "\t\t" + id_to_name(res) + " = " + id_to_name(true_value) + ";\n";
+		append_text(code, "\t\t", id_to_name(res), " = ", id_to_name(true_value), ";\n");
 		code += "\t}\n\telse\n\t{\n";
 		code += (false_statement_block != condition_block ? false_statement_data : std::string());
-		code += "\t\t" + id_to_name(res) + " = " + id_to_name(false_value) + ";\n";
+		append_text(code, "\t\t", id_to_name(res), " = ", id_to_name(false_value), ";\n");
 		code += "\t}\n";
 
 		// Remove consumed blocks to save memory
@@ -1618,7 +1619,7 @@ private:
 			for (size_t offset = 0; (offset = loop_data.find(continue_id, offset)) != std::string::npos; offset += continue_data.size())
 				loop_data.replace(offset, continue_id.size(), continue_data);
 
-			code += "\tbool " + condition_name + ";\n";
+			append_text(code, "\tbool ", condition_name, ";\n");
 
 			write_location(code, loc);
 
@@ -1627,7 +1628,7 @@ private:
 			code += loop_data; // Encapsulate loop body into another scope, so not to confuse any local variables with the current iteration variable accessed in the continue block below
 			code += "\t\t}\n";
 			code += continue_data;
-			code += "\t}\n\twhile (" + condition_name + ");\n";
+			append_text(code, "\t}\n\twhile (", condition_name, ");\n");
 		}
 		else
 		{
@@ -1662,7 +1663,7 @@ private:
 				loop_data.replace(offset, continue_id.size(), continue_data + condition_data);
 
 			code += '\t';
-			code += "while (" + condition_name + ")\n\t{\n\t\t{\n";
+			append_text(code, "while (", condition_name, ")\n\t{\n\t\t{\n");
 			code += loop_data;
 			code += "\t\t}\n";
 			code += continue_data;
@@ -1689,7 +1690,7 @@ private:
 
 		write_location(code, loc);
 
-		code += "\tswitch (" + id_to_name(selector_value) + ")\n\t{\n";
+		append_text(code, "\tswitch (", id_to_name(selector_value), ")\n\t{\n");
 
 		std::vector<id> labels = case_literal_and_labels;
 		for (size_t i = 0; i < labels.size(); i += 2)
@@ -1697,7 +1698,7 @@ private:
 			if (labels[i + 1] == 0)
 				continue; // Happens if a case was already handled, see below
 
-			code += "\tcase " + std::to_string(labels[i]) + ": ";
+			append_text(code, "\tcase ", labels[i], ": ");
 
 			if (labels[i + 1] == default_label)
 			{
@@ -1711,7 +1712,7 @@ private:
 					if (labels[k + 1] == 0 || labels[k + 1] != labels[i + 1])
 						continue;
 
-					code += "case " + std::to_string(labels[k]) + ": ";
+					append_text(code, "case ", labels[k], ": ");
 					labels[k + 1] = 0;
 				}
 			}
@@ -1803,7 +1804,7 @@ private:
 		code += "\treturn";
 
 		if (value != 0)
-			code += ' ' + id_to_name(value);
+			append_text(code, ' ', id_to_name(value));
 
 		code += ";\n";
 
@@ -1829,7 +1830,7 @@ private:
 			code += "\tbreak;\n";
 			break;
 		case 2: // Keep track of continue target block, so we can insert its code here later
-			code += "__CONTINUE__" + std::to_string(target) + "\tcontinue;\n";
+			append_text(code, "__CONTINUE__", target, "\tcontinue;\n");
 			break;
 		}
 
@@ -1846,7 +1847,7 @@ private:
 	{
 		assert(_last_block != 0);
 
-		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+		append_text(_blocks.at(0), "{\n", _blocks.at(_last_block), "}\n");
 	}
 };
 
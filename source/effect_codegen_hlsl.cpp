@@ -5,6 +5,7 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_text.hpp"
 #include <cmath> // signbit, isinf, isnan
 #include <cstdio> // snprintf
 #include <cassert>
@@ -36,9 +37,9 @@ private:
 	};
 
 	std::string _cbuffer_block;
-	std::string _current_location;
-	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	uint32_t _current_source_id = 0;
+	std::pmr::unordered_map<id, std::string> _names { arena() };
+	std::pmr::unordered_map<id, std::string> _blocks { arena() };
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	unsigned int _shader_model = 0;
@@ -55,7 +56,7 @@ private:
 			module.hlsl += "struct __sampler2D { Texture2D t; SamplerState s; };\n";
 
 			if (!_cbuffer_block.empty())
-				module.hlsl += "cbuffer _Globals {\n" + _cbuffer_block + "};\n";
+				append_text(module.hlsl, "cbuffer _Globals {\n", _cbuffer_block, "};\n");
 		}
 		else
 		{
@@ -179,9 +180,9 @@ private:
 		}
 
 		if (type.rows > 1)
-			s += std::to_string(type.rows);
+			append_text(s, type.rows);
 		if (type.cols > 1)
-			s += 'x' + std::to_string(type.cols);
+			append_text(s, 'x', type.cols);
 	}
 	void write_constant(std::string &s, const type &type, const constant &data) const
 	{
@@ -194,7 +195,7 @@ private:
 
 			for (int i = 0; i < type.array_length; ++i)
 			{
-				write_constant(s, elem_type, i < static_cast<int>(data.array_data.size()) ? data.array_data[i] : constant());
+				write_constant(s, elem_type, i < static_cast<int>(data.array_data->size()) ? (*data.array_data)[i] : constant());
 
 				if (i < type.array_length - 1)
 					s += ", ";
@@ -209,7 +210,7 @@ private:
 			// The can only be zero initializer struct constants
 			assert(data.as_uint[0] == 0);
 
-			s += '(' + id_to_name(type.definition) + ")0";
+			append_text(s, '(', id_to_name(type.definition), ")0");
 			return;
 		}
 
@@ -228,11 +229,11 @@ private:
 				break;
 			case type::t_min16int:
 			case type::t_int:
-				s += std::to_string(data.as_int[i]);
+				append_text(s, data.as_int[i]);
 				break;
 			case type::t_min16uint:
 			case type::t_uint:
-				s += std::to_string(data.as_uint[i]);
+				append_text(s, data.as_uint[i]);
 				break;
 			case type::t_min16float:
 			case type::t_float:
@@ -262,23 +263,23 @@ private:
 	template <bool force_source = false>
 	void write_location(std::string &s, const location &loc)
 	{
-		if (loc.source.empty() || !_debug_info)
+		if (loc.source_id == 0 || _sources == nullptr || !_debug_info)
 			return;
 
-		s += "#line " + std::to_string(loc.line);
+		append_text(s, "#line ", loc.line);
 
 		size_t offset = s.size();
 
 		// Avoid writing the file name every time to reduce output text size
 		if constexpr (force_source)
 		{
-			s += " \"" + loc.source + '\"';
+			append_text(s, " \"", (*_sources)[loc], '\"');
 		}
-		else if (loc.source != _current_location)
+		else if (loc.source_id != _current_source_id)
 		{
-			s += " \"" + loc.source + '\"';
+			append_text(s, " \"", (*_sources)[loc], '\"');
 
-			_current_location = loc.source;
+			_current_source_id = loc.source_id;
 		}
 
 		// Need to escape string for new DirectX Shader Compiler (dxc)
@@ -308,7 +309,7 @@ private:
 		name = escape_name(std::move(name));
 		if constexpr (naming_type == naming::general)
 			if (std::find_if(_names.begin(), _names.end(), [&name](const auto &it) { return it.second == name; }) != _names.end())
-				name += '_' + std::to_string(id); // Append a numbered suffix if the name already exists
+				append_text(name, '_', id); // Append a numbered suffix if the name already exists
 		_names[id] = std::move(name);
 	}
 
@@ -379,17 +380,17 @@ private:
 
 		write_location(code, loc);
 
-		code += "struct " + id_to_name(info.definition) + "\n{\n";
+		append_text(code, "struct ", id_to_name(info.definition), "\n{\n");
 
 		for (const auto &member : info.member_list)
 		{
 			code += '\t';
 			write_type<true>(code, member.type); // HLSL allows interpolation attributes on struct members, so handle this like a parameter
-			code += ' ' + member.name;
+			append_text(code, ' ', member.name);
 			if (member.type.is_array())
-				code += '[' + std::to_string(member.type.array_length) + ']';
+				append_text(code, '[', member.type.array_length, ']');
 			if (!member.semantic.empty())
-				code += " : " + convert_semantic(member.semantic);
+				append_text(code, " : ", convert_semantic(member.semantic));
 			code += ";\n";
 		}
 
@@ -413,8 +414,8 @@ private:
 
 			write_location(code, loc);
 
-			code += "Texture2D __"     + info.unique_name + " : register(t" + std::to_string(info.binding + 0) + ");\n";
-			code += "Texture2D __srgb" + info.unique_name + " : register(t" + std::to_string(info.binding + 1) + ");\n";
+			append_text(code, "Texture2D __", info.unique_name, " : register(t", info.binding + 0, ");\n");
+			append_text(code, "Texture2D __srgb", info.unique_name, " : register(t", info.binding + 1, ");\n");
 		}
 
 		_module.textures.push_back(info);
@@ -447,7 +448,7 @@ private:
 			{
 				info.binding = _module.num_sampler_bindings++;
 
-				code += "SamplerState __s" + std::to_string(info.binding) + " : register(s" + std::to_string(info.binding) + ");\n";
+				append_text(code, "SamplerState __s", info.binding, " : register(s", info.binding, ");\n");
 			}
 
 			assert(info.srgb == 0 || info.srgb == 1);
@@ -455,23 +456,23 @@ private:
 
 			write_location(code, loc);
 
-			code += "static const __sampler2D " + id_to_name(info.id) + " = { " + (info.srgb ? "__srgb" : "__") + info.texture_name + ", __s" + std::to_string(info.binding) + " };\n";
+			append_text(code, "static const __sampler2D ", id_to_name(info.id), " = { ", (info.srgb ? "__srgb" : "__"), info.texture_name, ", __s", info.binding, " };\n");
 		}
 		else
 		{
 			info.binding = _module.num_sampler_bindings++;
 			info.texture_binding = ~0u; // Unset texture binding
 
-			code += "sampler2D __" + info.unique_name + "_s : register(s" + std::to_string(info.binding) + ");\n";
+			append_text(code, "sampler2D __", info.unique_name, "_s : register(s", info.binding, ");\n");
 
 			write_location(code, loc);
 
-			code += "static const __sampler2D " + id_to_name(info.id) + " = { __" + info.unique_name + "_s, float2(";
+			append_text(code, "static const __sampler2D ", id_to_name(info.id), " = { __", info.unique_name, "_s, float2(");
 
 			if (texture->semantic.empty())
-				code += "1.0 / " + std::to_string(texture->width) + ", 1.0 / " + std::to_string(texture->height);
+				append_text(code, "1.0 / ", texture->width, ", 1.0 / ", texture->height);
 			else
-				code += texture->semantic + "_PIXEL_SIZE"; // Expect application to set inverse texture size via a define if it is not known here
+				append_text(code, texture->semantic, "_PIXEL_SIZE"); // Expect application to set inverse texture size via a define if it is not known here
 
 			code += ") }; \n";
 		}
@@ -495,7 +496,7 @@ private:
 
 			write_location(code, loc);
 
-			code += "RWTexture2D<float4> " + info.unique_name + " : register(u" + std::to_string(info.binding) + ");\n";
+			append_text(code, "RWTexture2D<float4> ", info.unique_name, " : register(u", info.binding, ");\n");
 		}
 
 		_module.storages.push_back(info);
@@ -520,10 +521,10 @@ private:
 
 			code += "static const ";
 			write_type(code, info.type);
-			code += ' ' + id_to_name(res) + " = ";
+			append_text(code, ' ', id_to_name(res), " = ");
 			if (!info.type.is_scalar())
 				write_type<false, false>(code, info.type);
-			code += "(SPEC_CONSTANT_" + info.name + ");\n";
+			append_text(code, "(SPEC_CONSTANT_", info.name, ");\n");
 
 			_module.spec_constants.push_back(info);
 		}
@@ -565,16 +566,16 @@ private:
 			}
 
 			write_type(_cbuffer_block, type);
-			_cbuffer_block += ' ' + id_to_name(res);
+			append_text(_cbuffer_block, ' ', id_to_name(res));
 
 			if (info.type.is_array())
-				_cbuffer_block += '[' + std::to_string(info.type.array_length) + ']';
+				append_text(_cbuffer_block, '[', info.type.array_length, ']');
 
 			if (_shader_model < 40)
 			{
 				// Every constant register is 16 bytes wide, so divide memory offset by 16 to get the constant register index
 				// Note: All uniforms are floating-point in shader model 3, even if the uniform type says different!!
-				_cbuffer_block += " : register(c" + std::to_string(info.offset / 16) + ')';
+				append_text(_cbuffer_block, " : register(c", info.offset / 16, ')');
 			}
 
 			_cbuffer_block += ";\n";
@@ -599,13 +600,13 @@ private:
 			code += '\t';
 
 		write_type(code, type);
-		code += ' ' + id_to_name(res);
+		append_text(code, ' ', id_to_name(res));
 
 		if (type.is_array())
-			code += '[' + std::to_string(type.array_length) + ']';
+			append_text(code, '[', type.array_length, ']');
 
 		if (initializer_value != 0)
-			code += " = " + id_to_name(initializer_value);
+			append_text(code, " = ", id_to_name(initializer_value));
 
 		code += ";\n";
 
@@ -622,7 +623,7 @@ private:
 		write_location(code, loc);
 
 		write_type(code, info.return_type);
-		code += ' ' + id_to_name(info.definition) + '(';
+		append_text(code, ' ', id_to_name(info.definition), '(');
 
 		for (size_t i = 0, num_params = info.parameter_list.size(); i < num_params; ++i)
 		{
@@ -635,13 +636,13 @@ private:
 			write_location(code, param.location);
 			code += '\t';
 			write_type<true>(code, param.type);
-			code += ' ' + id_to_name(param.definition);
+			append_text(code, ' ', id_to_name(param.definition));
 
 			if (param.type.is_array())
-				code += '[' + std::to_string(param.type.array_length) + ']';
+				append_text(code, '[', param.type.array_length, ']');
 
 			if (!param.semantic.empty())
-				code += " : " + convert_semantic(param.semantic);
+				append_text(code, " : ", convert_semantic(param.semantic));
 
 			if (i < num_params - 1)
 				code += ',';
@@ -650,7 +651,7 @@ private:
 		code += ')';
 
 		if (!info.return_semantic.empty())
-			code += " : " + convert_semantic(info.return_semantic);
+			append_text(code, " : ", convert_semantic(info.return_semantic));
 
 		code += '\n';
 
@@ -751,22 +752,22 @@ private:
 		for (struct_member_info &param : entry_point.parameter_list)
 		{
 			if (is_color_semantic(param.semantic))
-				code += '\t' + param.name + " = float4(0.0, 0.0, 0.0, 0.0);\n";
+				append_text(code, '\t', param.name, " = float4(0.0, 0.0, 0.0, 0.0);\n");
 		}
 
 		code += '\t';
 		if (is_color_semantic(func.return_semantic))
 		{
-			code += "const float4 " + id_to_name(ret) + " = float4(";
+			append_text(code, "const float4 ", id_to_name(ret), " = float4(");
 		}
 		else if (!func.return_type.is_void())
 		{
 			write_type(code, func.return_type);
-			code += ' ' + id_to_name(ret) + " = ";
+			append_text(code, ' ', id_to_name(ret), " = ");
 		}
 
 		// Call the function this entry point refers to
-		code += id_to_name(func.definition) + '(';
+		append_text(code, id_to_name(func.definition), '(');
 
 		for (size_t i = 0, num_params = func.parameter_list.size(); i < num_params; ++i)
 		{
@@ -788,7 +789,7 @@ private:
 		// Cast the output value to a four-component vector
 		if (is_color_semantic(func.return_semantic))
 		{
-			for (unsigned int i = 0; i < 4 - func.return_type.rows; i++)
+			for (int i = 0; i < 4 - static_cast<int>(func.return_type.rows); i++)
 				code += ", 0.0";
 			code += ')';
 		}
@@ -797,7 +798,7 @@ private:
 
 		// Shift everything by half a viewport pixel to workaround the different half-pixel offset in D3D9 (https://aras-p.info/blog/2016/04/08/solving-dx9-half-pixel-offset/)
 		if (!position_variable_name.empty() && stype == shader_type::vs) // Check if we are in a vertex shader definition
-			code += '\t' + position_variable_name + ".xy += __TEXEL_SIZE__ * " + position_variable_name + ".ww;\n";
+			append_text(code, '\t', position_variable_name, ".xy += __TEXEL_SIZE__ * ", position_variable_name, ".ww;\n");
 
 		leave_block_and_return(func.return_type.is_void() ? 0 : ret);
 		leave_function();
@@ -836,14 +837,14 @@ private:
 				expr_code += find_struct(op.from.definition).member_list[op.index].name;
 				break;
 			case expression::operation::op_dynamic_index:
-				expr_code += '[' + id_to_name(op.index) + ']';
+				append_text(expr_code, '[', id_to_name(op.index), ']');
 				break;
 			case expression::operation::op_constant_index:
 				if (op.from.is_vector() && !op.from.is_array())
 					expr_code += '.',
 					expr_code += "xyzw"[op.index];
 				else
-					expr_code += '[' + std::to_string(op.index) + ']';
+					append_text(expr_code, '[', op.index, ']');
 				break;
 			case expression::operation::op_swizzle:
 				expr_code += '.';
@@ -863,7 +864,7 @@ private:
 
 			code += '\t';
 			write_type(code, exp.type);
-			code += ' ' + id_to_name(res) + " = " + expr_code + ";\n";
+			append_text(code, ' ', id_to_name(res), " = ", expr_code, ";\n");
 		}
 		else
 		{
@@ -879,7 +880,7 @@ private:
 
 		write_location(code, exp.location);
 
-		code += '\t' + id_to_name(exp.base);
+		append_text(code, '\t', id_to_name(exp.base));
 
 		static const char s_matrix_swizzles[16][5] = {
 			"_m00", "_m01", "_m02", "_m03",
@@ -897,10 +898,10 @@ private:
 				code += find_struct(op.from.definition).member_list[op.index].name;
 				break;
 			case expression::operation::op_dynamic_index:
-				code += '[' + id_to_name(op.index) + ']';
+				append_text(code, '[', id_to_name(op.index), ']');
 				break;
 			case expression::operation::op_constant_index:
-				code += '[' + std::to_string(op.index) + ']';
+				append_text(code, '[', op.index, ']');
 				break;
 			case expression::operation::op_swizzle:
 				code += '.';
@@ -913,7 +914,7 @@ private:
 			}
 		}
 
-		code += " = " + id_to_name(value) + ";\n";
+		append_text(code, " = ", id_to_name(value), ";\n");
 	}
 
 	id   emit_constant(const type &type, const constant &data) override
@@ -927,8 +928,8 @@ private:
 			// Array constants need to be stored in a constant variable as they cannot be used in-place
 			code += "\tconst ";
 			write_type(code, type);
-			code += ' ' + id_to_name(res);
-			code += '[' + std::to_string(type.array_length) + ']';
+			append_text(code, ' ', id_to_name(res));
+			append_text(code, '[', type.array_length, ']');
 			code += " = ";
 			write_constant(code, type, data);
 			code += ";\n";
@@ -952,14 +953,14 @@ private:
 
 		code += '\t';
 		write_type(code, res_type);
-		code += ' ' + id_to_name(res) + " = ";
+		append_text(code, ' ', id_to_name(res), " = ");
 
 		if (_shader_model < 40 && op == tokenid::tilde)
 			code += "0xFFFFFFFF - "; // Emulate bitwise not operator on shader model 3
 		else
 			code += char(op);
 
-		code += id_to_name(val) + ";\n";
+		append_text(code, id_to_name(val), ";\n");
 
 		return res;
 	}
@@ -973,7 +974,7 @@ private:
 
 		code += '\t';
 		write_type(code, res_type);
-		code += ' ' + id_to_name(res) + " = ";
+		append_text(code, ' ', id_to_name(res), " = ");
 
 		if (_shader_model < 40)
 		{
@@ -984,7 +985,7 @@ private:
 				code += "floor(";
 		}
 
-		code += id_to_name(lhs) + ' ';
+		append_text(code, id_to_name(lhs), ' ');
 
 		switch (op)
 		{
@@ -1058,7 +1059,7 @@ private:
 			assert(false);
 		}
 
-		code += ' ' + id_to_name(rhs);
+		append_text(code, ' ', id_to_name(rhs));
 
 		if (_shader_model < 40)
 		{
@@ -1085,16 +1086,16 @@ private:
 
 		code += '\t';
 		write_type(code, res_type);
-		code += ' ' + id_to_name(res);
+		append_text(code, ' ', id_to_name(res));
 
 		if (res_type.is_array())
-			code += '[' + std::to_string(res_type.array_length) + ']';
+			append_text(code, '[', res_type.array_length, ']');
 
-		code += " = " + id_to_name(condition) + " ? " + id_to_name(true_value) + " : " + id_to_name(false_value) + ";\n";
+		append_text(code, " = ", id_to_name(condition), " ? ", id_to_name(true_value), " : ", id_to_name(false_value), ";\n");
 
 		return res;
 	}
-	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call(const location &loc, id function, const type &res_type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1112,15 +1113,15 @@ private:
 		if (!res_type.is_void())
 		{
 			write_type(code, res_type);
-			code += ' ' + id_to_name(res);
+			append_text(code, ' ', id_to_name(res));
 
 			if (res_type.is_array())
-				code += '[' + std::to_string(res_type.array_length) + ']';
+				append_text(code, '[', res_type.array_length, ']');
 
 			code += " = ";
 		}
 
-		code += id_to_name(function) + '(';
+		append_text(code, id_to_name(function), '(');
 
 		for (size_t i = 0, num_args = args.size(); i < num_args; ++i)
 		{
@@ -1134,7 +1135,7 @@ private:
 
 		return res;
 	}
-	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1164,12 +1165,12 @@ private:
 			// Implementation of the 'tex2Dsize' intrinsic passes the result variable into 'GetDimensions' as output argument
 			// Same with the atomic intrinsics, which use the last parameter to return the previous value of the target
 			write_type(code, res_type);
-			code += ' ' + id_to_name(res) + "; ";
+			append_text(code, ' ', id_to_name(res), "; ");
 		}
 		else if (!res_type.is_void())
 		{
 			write_type(code, res_type);
-			code += ' ' + id_to_name(res) + " = ";
+			append_text(code, ' ', id_to_name(res), " = ");
 		}
 
 		switch (intrinsic)
@@ -1184,7 +1185,7 @@ private:
 
 		return res;
 	}
-	id   emit_construct(const location &loc, const type &type, const std::vector<expression> &args) override
+	id   emit_construct(const location &loc, const type &type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const auto &arg : args)
@@ -1199,10 +1200,10 @@ private:
 
 		code += '\t';
 		write_type(code, type);
-		code += ' ' + id_to_name(res);
+		append_text(code, ' ', id_to_name(res));
 
 		if (type.is_array())
-			code += '[' + std::to_string(type.array_length) + ']';
+			append_text(code, '[', type.array_length, ']');
 
 		code += " = ";
 
@@ -1250,7 +1251,7 @@ private:
 		if (flags & 0x1) code += "[flatten] ";
 		if (flags & 0x2) code += "[branch] ";
 
-		code += "if (" + id_to_name(condition_value) + ")\n\t{\n";
+		append_text(code, "if (", id_to_name(condition_value), ")\n\t{\n");
 		code += true_statement_data;
 		code += "\t}\n";
 
@@ -1284,16 +1285,16 @@ private:
 
 		code += '\t';
 		write_type(code, type);
-		code += ' ' + id_to_name(res) + ";\n";
+		append_text(code, ' ', id_to_name(res), ";\n");
 
 		write_location(code, loc);
 
-		code += "\tif (" + id_to_name(condition_value) + ")\n\t{\n";
+		append_text(code, "\tif (", id_to_name(condition_value), ")\n\t{\n");
 		code += (true_statement_block != condition_block ? true_statement_data : std::string());
-		code += "\t\t" + id_to_name(res) + " = " + id_to_name(true_value) + ";\n";
+		append_text(code, "\t\t", id_to_name(res), " = ", id_to_name(true_value), ";\n");
 		code += "\t}\n\telse\n\t{\n";
 		code += (false_statement_block != condition_block ? false_statement_data : std::string());
-		code += "\t\t" + id_to_name(res) + " = " + id_to_name(false_value) + ";\n";
+		append_text(code, "\t\t", id_to_name(res), " = ", id_to_name(false_value), ";\n");
 		code += "\t}\n";
 
 		// Remove consumed blocks to save memory
@@ -1339,16 +1340,16 @@ private:
 			for (size_t offset = 0; (offset = loop_data.find(continue_id, offset)) != std::string::npos; offset += continue_data.size())
 				loop_data.replace(offset, continue_id.size(), continue_data);
 
-			code += "\tbool " + condition_name + ";\n";
+			append_text(code, "\tbool ", condition_name, ";\n");
 
 			write_location(code, loc);
 
-			code += '\t' + attributes;
+			append_text(code, '\t', attributes);
 			code += "do\n\t{\n\t\t{\n";
 			code += loop_data; // Encapsulate loop body into another scope, so not to confuse any local variables with the current iteration variable accessed in the continue block below
 			code += "\t\t}\n";
 			code += continue_data;
-			code += "\t}\n\twhile (" + condition_name + ");\n";
+			append_text(code, "\t}\n\twhile (", condition_name, ");\n");
 		}
 		else
 		{
@@ -1392,11 +1393,11 @@ private:
 
 			write_location(code, loc);
 
-			code += '\t' + attributes;
+			append_text(code, '\t', attributes);
 			if (use_break_statement_for_condition)
-				code += "while (true)\n\t{\n\t\tif (" + condition_name + ")\n\t\t{\n";
+				append_text(code, "while (true)\n\t{\n\t\tif (", condition_name, ")\n\t\t{\n");
 			else
-				code += "while (" + condition_name + ")\n\t{\n\t\t{\n";
+				append_text(code, "while (", condition_name, ")\n\t{\n\t\t{\n");
 			code += loop_data;
 			code += "\t\t}\n";
 			if (use_break_statement_for_condition)
@@ -1434,7 +1435,7 @@ private:
 			if (flags & 0x4) code += "[forcecase] ";
 			if (flags & 0x8) code += "[call] ";
 
-			code += "switch (" + id_to_name(selector_value) + ")\n\t{\n";
+			append_text(code, "switch (", id_to_name(selector_value), ")\n\t{\n");
 
 			std::vector<id> labels = case_literal_and_labels;
 			for (size_t i = 0; i < labels.size(); i += 2)
@@ -1442,7 +1443,7 @@ private:
 				if (labels[i + 1] == 0)
 					continue; // Happens if a case was already handled, see below
 
-				code += "\tcase " + std::to_string(labels[i]) + ": ";
+				append_text(code, "\tcase ", labels[i], ": ");
 
 				if (labels[i + 1] == default_label)
 				{
@@ -1456,7 +1457,7 @@ private:
 						if (labels[k + 1] == 0 || labels[k + 1] != labels[i + 1])
 							continue;
 
-						code += "case " + std::to_string(labels[k]) + ": ";
+						append_text(code, "case ", labels[k], ": ");
 						labels[k + 1] = 0;
 					}
 				}
@@ -1501,14 +1502,14 @@ private:
 				if (labels[i + 1] == 0)
 					continue; // Happens if a case was already handled, see below
 
-				code += "if (" + id_to_name(selector_value) + " == " + std::to_string(labels[i]);
+				append_text(code, "if (", id_to_name(selector_value), " == ", labels[i]);
 
 				for (size_t k = i + 2; k < labels.size(); k += 2)
 				{
 					if (labels[k + 1] == 0 || labels[k + 1] != labels[i + 1])
 						continue;
 
-					code += " || " + id_to_name(selector_value) + " == " + std::to_string(labels[k]);
+					append_text(code, " || ", id_to_name(selector_value), " == ", labels[k]);
 					labels[k + 1] = 0;
 				}
 
@@ -1601,7 +1602,7 @@ private:
 		code += "\treturn";
 
 		if (value != 0)
-			code += ' ' + id_to_name(value);
+			append_text(code, ' ', id_to_name(value));
 
 		code += ";\n";
 
@@ -1627,7 +1628,7 @@ private:
 			code += "\tbreak;\n";
 			break;
 		case 2: // Keep track of continue target block, so we can insert its code here later
-			code += "__CONTINUE__" + std::to_string(target) + "\tcontinue;\n";
+			append_text(code, "__CONTINUE__", target, "\tcontinue;\n");
 			break;
 		}
 
@@ -1644,7 +1645,7 @@ private:
 	{
 		assert(_last_block != 0);
 
-		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+		append_text(_blocks.at(0), "{\n", _blocks.at(_last_block), "}\n");
 	}
 };
 
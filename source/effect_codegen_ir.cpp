@@ -0,0 +1,1354 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_codegen.hpp"
+#include <cstring> // std::memcpy
+#include <unordered_map>
+
+using namespace reshadefx;
+
+namespace
+{
+	// Every recording starts with these two words, followed by the source file names and the recorded calls
+	constexpr uint32_t ir_magic = 0x52495846; // 'FXIR'
+	constexpr uint32_t ir_version = 1;
+
+	/// <summary>
+	/// A list of all the calls that can be recorded. Each call is stored as its opcode, followed by the result ID (if any) and the arguments.
+	/// </summary>
+	enum class ir_op : uint32_t
+	{
+		define_struct,
+		define_texture,
+		define_sampler,
+		define_storage,
+		define_uniform,
+		define_variable,
+		define_function,
+		define_entry_point,
+
+		emit_load,
+		emit_store,
+		emit_access_chain,
+		emit_constant,
+		emit_unary_op,
+		emit_binary_op,
+		emit_ternary_op,
+		emit_call,
+		emit_call_intrinsic,
+		emit_construct,
+		emit_if,
+		emit_phi,
+		emit_loop,
+		emit_switch,
+
+		create_block,
+		set_block,
+		enter_block,
+		leave_block_and_kill,
+		leave_block_and_return,
+		leave_block_and_switch,
+		leave_block_and_branch,
+		leave_block_and_branch_conditional,
+		leave_function,
+
+		// The parser modifies texture information and adds techniques without going through a virtual call, so these are appended at the end of the recording
+		update_texture,
+		define_technique,
+	};
+}
+
+class codegen_ir final : public codegen_recorder
+{
+	std::vector<uint32_t> _stream;
+	std::vector<std::string> _source_names = { std::string() };
+
+	void write_result(module &module) override
+	{
+		// All information is only known after the recording was replayed into the actual back-end
+		module = reshadefx::module();
+	}
+	void write_recording(std::vector<uint32_t> &ir) override
+	{
+		for (const texture_info &info : _module.textures)
+		{
+			write(ir_op::update_texture);
+			write(info.id);
+			write(info.render_target | (info.storage_access << 1));
+		}
+
+		for (const technique_info &info : _module.techniques)
+		{
+			write(ir_op::define_technique);
+			write(info.name);
+			write(info.annotations);
+			write(static_cast<uint32_t>(info.passes.size()));
+			for (const pass_info &pass : info.passes)
+				write(pass);
+		}
+
+		std::vector<uint32_t> records = std::move(_stream);
+
+		_stream = { ir_magic, ir_version, static_cast<uint32_t>(_source_names.size() - 1) };
+		for (size_t i = 1; i < _source_names.size(); ++i)
+			write(_source_names[i]);
+		_stream.insert(_stream.end(), records.begin(), records.end());
+
+		ir = std::move(_stream);
+	}
+
+	void write(uint32_t value)
+	{
+		_stream.push_back(value);
+	}
+	void write(ir_op op)
+	{
+		_stream.push_back(static_cast<uint32_t>(op));
+	}
+	void write_float(float value)
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		_stream.push_back(bits);
+	}
+	void write(const std::string &value)
+	{
+		_stream.push_back(static_cast<uint32_t>(value.size()));
+
+		// Pack characters into words, padding the last one with zeroes
+		const size_t offset = _stream.size();
+		_stream.resize(offset + (value.size() + 3) / 4);
+		std::memcpy(_stream.data() + offset, value.data(), value.size());
+	}
+	void write(const type &type)
+	{
+		// Most types fit into a single word, qualifiers, array length and struct definition only follow if they are set
+		write(type.base | (type.rows << 8) | (type.cols << 16) |
+			(type.qualifiers != 0 ? 1u << 24 : 0) | (type.array_length != 0 ? 1u << 25 : 0) | (type.definition != 0 ? 1u << 26 : 0));
+		if (type.qualifiers != 0)
+			write(type.qualifiers);
+		if (type.array_length != 0)
+			write(static_cast<uint32_t>(type.array_length));
+		if (type.definition != 0)
+			write(type.definition);
+	}
+	void write(const location &loc)
+	{
+		// Collect source file names as they are referenced, since the source table only lives as long as the parser
+		if (_sources != nullptr)
+			while (_source_names.size() <= loc.source_id)
+				_source_names.push_back((*_sources)[static_cast<uint32_t>(_source_names.size())]);
+
+		write(loc.source_id);
+		write(loc.line);
+		write(loc.column);
+	}
+	void write(const constant &data)
+	{
+		// Trailing zero components are omitted
+		uint32_t num_words = 16;
+		while (num_words != 0 && data.as_uint[num_words - 1] == 0)
+			--num_words;
+
+		const bool has_string = !data.string_data->empty();
+		const bool has_array = !data.array_data->empty();
+
+		write(num_words | (has_string << 8) | (has_array << 9));
+		_stream.insert(_stream.end(), data.as_uint, data.as_uint + num_words);
+
+		if (has_string)
+			write(*data.string_data);
+		if (has_array)
+		{
+			write(static_cast<uint32_t>(data.array_data->size()));
+			for (const constant &element : *data.array_data)
+				write(element);
+		}
+	}
+	void write(const expression &exp)
+	{
+		write(exp.base);
+		write(exp.type);
+		write(exp.is_lvalue | (exp.is_constant << 1));
+		if (exp.is_constant)
+			write(exp.constant);
+		write(exp.location);
+
+		write(static_cast<uint32_t>(exp.chain.size()));
+		for (const expression::operation &op : exp.chain)
+		{
+			write(static_cast<uint32_t>(op.op));
+			write(op.from);
+			write(op.to);
+			write(op.index);
+
+			uint32_t swizzle;
+			std::memcpy(&swizzle, op.swizzle, sizeof(swizzle));
+			write(swizzle);
+		}
+	}
+	void write(const std::pmr::vector<expression> &args)
+	{
+		write(static_cast<uint32_t>(args.size()));
+		for (const expression &arg : args)
+			write(arg);
+	}
+	void write(const std::vector<annotation> &annotations)
+	{
+		write(static_cast<uint32_t>(annotations.size()));
+		for (const annotation &annotation : annotations)
+		{
+			write(annotation.type);
+			write(annotation.name);
+			write(annotation.value);
+		}
+	}
+	void write(const struct_member_info &member)
+	{
+		write(member.type);
+		write(member.name);
+		write(member.semantic);
+		write(member.location);
+	}
+	void write(const pass_info &pass)
+	{
+		write(pass.name);
+		for (const std::string &name : pass.render_target_names)
+			write(name);
+		write(pass.vs_entry_point);
+		write(pass.ps_entry_point);
+		write(pass.cs_entry_point);
+		write(pass.clear_render_targets);
+		write(pass.srgb_write_enable);
+		write(pass.blend_enable);
+		write(pass.stencil_enable);
+		write(pass.color_write_mask);
+		write(pass.stencil_read_mask);
+		write(pass.stencil_write_mask);
+		write(static_cast<uint32_t>(pass.blend_op));
+		write(static_cast<uint32_t>(pass.blend_op_alpha));
+		write(static_cast<uint32_t>(pass.src_blend));
+		write(static_cast<uint32_t>(pass.dest_blend));
+		write(static_cast<uint32_t>(pass.src_blend_alpha));
+		write(static_cast<uint32_t>(pass.dest_blend_alpha));
+		write(static_cast<uint32_t>(pass.stencil_comparison_func));
+		write(pass.stencil_reference_value);
+		write(static_cast<uint32_t>(pass.stencil_op_pass));
+		write(static_cast<uint32_t>(pass.stencil_op_fail));
+		write(static_cast<uint32_t>(pass.stencil_op_depth_fail));
+		write(pass.num_vertices);
+		write(static_cast<uint32_t>(pass.topology));
+		write(pass.viewport_width);
+		write(pass.viewport_height);
+		write(pass.viewport_dispatch_z);
+
+		// Samplers and storages are looked up again by ID in the actual back-end, since it assigns bindings
+		write(static_cast<uint32_t>(pass.samplers.size()));
+		for (const sampler_info &info : pass.samplers)
+			write(info.id);
+		write(static_cast<uint32_t>(pass.storages.size()));
+		for (const storage_info &info : pass.storages)
+			write(info.id);
+	}
+
+	id   define_struct(const location &loc, struct_info &info) override
+	{
+		info.definition = make_id();
+
+		write(ir_op::define_struct);
+		write(info.definition);
+		write(loc);
+		write(info.name);
+		write(info.unique_name);
+		write(static_cast<uint32_t>(info.member_list.size()));
+		for (const struct_member_info &member : info.member_list)
+			write(member);
+
+		_structs.push_back(info);
+
+		return info.definition;
+	}
+	id   define_texture(const location &loc, texture_info &info) override
+	{
+		info.id = make_id();
+
+		write(ir_op::define_texture);
+		write(info.id);
+		write(loc);
+		write(info.semantic);
+		write(info.unique_name);
+		write(info.annotations);
+		write(info.width);
+		write(info.height);
+		write(info.levels);
+		write(static_cast<uint32_t>(info.format));
+		write(info.render_target | (info.storage_access << 1));
+
+		_module.textures.push_back(info);
+
+		return info.id;
+	}
+	id   define_sampler(const location &loc, sampler_info &info) override
+	{
+		info.id = make_id();
+
+		write(ir_op::define_sampler);
+		write(info.id);
+		write(loc);
+		write(info.unique_name);
+		write(info.texture_name);
+		write(info.annotations);
+		write(static_cast<uint32_t>(info.filter));
+		write(static_cast<uint32_t>(info.address_u));
+		write(static_cast<uint32_t>(info.address_v));
+		write(static_cast<uint32_t>(info.address_w));
+		write_float(info.min_lod);
+		write_float(info.max_lod);
+		write_float(info.lod_bias);
+		write(info.srgb);
+
+		_module.samplers.push_back(info);
+
+		return info.id;
+	}
+	id   define_storage(const location &loc, storage_info &info) override
+	{
+		info.id = make_id();
+
+		write(ir_op::define_storage);
+		write(info.id);
+		write(loc);
+		write(info.unique_name);
+		write(info.texture_name);
+
+		_module.storages.push_back(info);
+
+		return info.id;
+	}
+	id   define_uniform(const location &loc, uniform_info &info) override
+	{
+		const id res = make_id();
+
+		write(ir_op::define_uniform);
+		write(res);
+		write(loc);
+		write(info.name);
+		write(info.type);
+		write(info.annotations);
+		write(info.has_initializer_value);
+		if (info.has_initializer_value)
+			write(info.initializer_value);
+
+		return res;
+	}
+	id   define_variable(const location &loc, const type &type, std::string name, bool global, id initializer_value) override
+	{
+		const id res = make_id();
+
+		write(ir_op::define_variable);
+		write(res);
+		write(loc);
+		write(type);
+		write(name);
+		write(global);
+		write(initializer_value);
+
+		return res;
+	}
+	id   define_function(const location &loc, function_info &info) override
+	{
+		info.definition = make_id();
+		for (struct_member_info &param : info.parameter_list)
+			param.definition = make_id();
+
+		write(ir_op::define_function);
+		write(info.definition);
+		write(loc);
+		write(info.name);
+		write(info.unique_name);
+		write(info.return_type);
+		write(info.return_semantic);
+		write(static_cast<uint32_t>(info.parameter_list.size()));
+		for (const struct_member_info &param : info.parameter_list)
+		{
+			write(param.definition);
+			write(param);
+		}
+
+		_functions.push_back(std::make_unique<function_info>(info));
+
+		return info.definition;
+	}
+
+	void define_entry_point(function_info &func, shader_type stype, int num_threads[3]) override
+	{
+		write(ir_op::define_entry_point);
+		write(func.definition);
+		write(static_cast<uint32_t>(stype));
+		if (stype == shader_type::cs)
+			for (int i = 0; i < 3; ++i)
+				write(static_cast<uint32_t>(num_threads[i]));
+
+		// Use the same naming scheme as the other back-ends, so that every thread configuration gets a separate name
+		// The replayer maps these names to the ones the actual back-end chose when updating the techniques
+		if (stype == shader_type::cs)
+			func.unique_name = 'E' + func.unique_name +
+				'_' + std::to_string(num_threads[0]) +
+				'_' + std::to_string(num_threads[1]) +
+				'_' + std::to_string(num_threads[2]);
+
+		write(func.unique_name);
+	}
+
+	id   emit_load(const expression &exp, bool force_new_id) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_load);
+		write(res);
+		write(exp);
+		write(force_new_id);
+
+		return res;
+	}
+	void emit_store(const expression &exp, id value) override
+	{
+		write(ir_op::emit_store);
+		write(exp);
+		write(value);
+	}
+	id   emit_access_chain(const expression &exp, size_t &chain_index) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_access_chain);
+		write(res);
+		write(exp);
+
+		chain_index = exp.chain.size();
+
+		return res;
+	}
+
+	id   emit_constant(const type &type, const constant &data) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_constant);
+		write(res);
+		write(type);
+		write(data);
+
+		return res;
+	}
+
+	id   emit_unary_op(const location &loc, tokenid op, const type &type, id val) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_unary_op);
+		write(res);
+		write(loc);
+		write(static_cast<uint32_t>(op));
+		write(type);
+		write(val);
+
+		return res;
+	}
+	id   emit_binary_op(const location &loc, tokenid op, const type &res_type, const type &type, id lhs, id rhs) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_binary_op);
+		write(res);
+		write(loc);
+		write(static_cast<uint32_t>(op));
+		write(res_type);
+		write(type);
+		write(lhs);
+		write(rhs);
+
+		return res;
+	}
+	id   emit_ternary_op(const location &loc, tokenid op, const type &type, id condition, id true_value, id false_value) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_ternary_op);
+		write(res);
+		write(loc);
+		write(static_cast<uint32_t>(op));
+		write(type);
+		write(condition);
+		write(true_value);
+		write(false_value);
+
+		return res;
+	}
+	id   emit_call(const location &loc, id function, const type &res_type, const std::pmr::vector<expression> &args) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_call);
+		write(res);
+		write(loc);
+		write(function);
+		write(res_type);
+		write(args);
+
+		return res;
+	}
+	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::pmr::vector<expression> &args) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_call_intrinsic);
+		write(res);
+		write(loc);
+		write(intrinsic);
+		write(res_type);
+		write(args);
+
+		return res;
+	}
+	id   emit_construct(const location &loc, const type &type, const std::pmr::vector<expression> &args) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_construct);
+		write(res);
+		write(loc);
+		write(type);
+		write(args);
+
+		return res;
+	}
+
+	void emit_if(const location &loc, id condition_value, id condition_block, id true_statement_block, id false_statement_block, unsigned int flags) override
+	{
+		write(ir_op::emit_if);
+		write(loc);
+		write(condition_value);
+		write(condition_block);
+		write(true_statement_block);
+		write(false_statement_block);
+		write(flags);
+	}
+	id   emit_phi(const location &loc, id condition_value, id condition_block, id true_value, id true_statement_block, id false_value, id false_statement_block, const type &type) override
+	{
+		const id res = make_id();
+
+		write(ir_op::emit_phi);
+		write(res);
+		write(loc);
+		write(condition_value);
+		write(condition_block);
+		write(true_value);
+		write(true_statement_block);
+		write(false_value);
+		write(false_statement_block);
+		write(type);
+
+		return res;
+	}
+	void emit_loop(const location &loc, id condition_value, id prev_block, id header_block, id condition_block, id loop_block, id continue_block, unsigned int flags) override
+	{
+		write(ir_op::emit_loop);
+		write(loc);
+		write(condition_value);
+		write(prev_block);
+		write(header_block);
+		write(condition_block);
+		write(loop_block);
+		write(continue_block);
+		write(flags);
+	}
+	void emit_switch(const location &loc, id selector_value, id selector_block, id default_label, id default_block, const std::vector<id> &case_literal_and_labels, const std::vector<id> &case_blocks, unsigned int flags) override
+	{
+		write(ir_op::emit_switch);
+		write(loc);
+		write(selector_value);
+		write(selector_block);
+		write(default_label);
+		write(default_block);
+		write(static_cast<uint32_t>(case_literal_and_labels.size()));
+		_stream.insert(_stream.end(), case_literal_and_labels.begin(), case_literal_and_labels.end());
+		write(static_cast<uint32_t>(case_blocks.size()));
+		_stream.insert(_stream.end(), case_blocks.begin(), case_blocks.end());
+		write(flags);
+	}
+
+	id   create_block() override
+	{
+		const id res = make_id();
+
+		write(ir_op::create_block);
+		write(res);
+
+		return res;
+	}
+	id   set_block(id id) override
+	{
+		write(ir_op::set_block);
+		write(id);
+
+		_last_block = _current_block;
+		_current_block = id;
+
+		return _last_block;
+	}
+	id   leave_block()
+	{
+		// Same as 'set_block(0)', but without recording it, since the other back-ends do this implicitly when leaving a block
+		_last_block = _current_block;
+		_current_block = 0;
+
+		return _last_block;
+	}
+	void enter_block(id id) override
+	{
+		write(ir_op::enter_block);
+		write(id);
+
+		_current_block = id;
+	}
+	id   leave_block_and_kill() override
+	{
+		write(ir_op::leave_block_and_kill);
+
+		if (!is_in_block())
+			return 0;
+
+		return leave_block();
+	}
+	id   leave_block_and_return(id value) override
+	{
+		write(ir_op::leave_block_and_return);
+		write(value);
+
+		if (!is_in_block())
+			return 0;
+
+		return leave_block();
+	}
+	id   leave_block_and_switch(id value, id default_target) override
+	{
+		write(ir_op::leave_block_and_switch);
+		write(value);
+		write(default_target);
+
+		if (!is_in_block())
+			return _last_block;
+
+		return leave_block();
+	}
+	id   leave_block_and_branch(id target, unsigned int loop_flow) override
+	{
+		write(ir_op::leave_block_and_branch);
+		write(target);
+		write(loop_flow);
+
+		if (!is_in_block())
+			return _last_block;
+
+		return leave_block();
+	}
+	id   leave_block_and_branch_conditional(id condition, id true_target, id false_target) override
+	{
+		write(ir_op::leave_block_and_branch_conditional);
+		write(condition);
+		write(true_target);
+		write(false_target);
+
+		if (!is_in_block())
+			return _last_block;
+
+		return leave_block();
+	}
+	void leave_function() override
+	{
+		write(ir_op::leave_function);
+	}
+};
+
+codegen_recorder *reshadefx::create_codegen_ir()
+{
+	return new codegen_ir();
+}
+
+class codegen_ir_replayer
+{
+public:
+	codegen_ir_replayer(const std::vector<uint32_t> &words, codegen *backend) : _words(words), _backend(backend) {}
+
+	bool replay()
+	{
+		if (read() != ir_magic || read() != ir_version)
+			return false;
+
+		_num_sources = 1 + read_count();
+		for (uint32_t source_id = 1; source_id < _num_sources && !_failed; ++source_id)
+			if (_sources.intern(read_string()) != source_id)
+				_failed = true;
+		if (_failed)
+			return false;
+
+		_backend->set_source_table(&_sources);
+
+		while (!_failed && _offset < _words.size())
+			replay_call();
+
+		// Source table is only valid during replay, the back-ends do not access it after all code was emitted
+		_backend->set_source_table(nullptr);
+
+		return !_failed;
+	}
+
+private:
+	// Marks IDs which were not returned by any recorded call yet
+	static constexpr codegen::id unbound = 0xFFFFFFFF;
+
+	uint32_t read()
+	{
+		if (_offset < _words.size())
+			return _words[_offset++];
+
+		_failed = true;
+		return 0;
+	}
+	uint32_t read_count()
+	{
+		// Every element takes up at least one word, so larger counts can only come from a malformed recording
+		const uint32_t count = read();
+		if (count > _words.size() - _offset)
+		{
+			_failed = true;
+			return 0;
+		}
+		return count;
+	}
+	float read_float()
+	{
+		const uint32_t bits = read();
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	std::string read_string()
+	{
+		const uint32_t length = read();
+		const size_t num_words = (static_cast<size_t>(length) + 3) / 4;
+		if (num_words > _words.size() - _offset)
+		{
+			_failed = true;
+			return std::string();
+		}
+
+		std::string value(reinterpret_cast<const char *>(_words.data() + _offset), length);
+		_offset += num_words;
+		return value;
+	}
+
+	codegen::id read_id()
+	{
+		const codegen::id recorded = read();
+		if (recorded == 0)
+			return 0;
+
+		if (recorded < _ids.size() && _ids[recorded] != unbound)
+			return _ids[recorded];
+
+		_failed = true;
+		return 0;
+	}
+	void bind_id(codegen::id recorded, codegen::id id)
+	{
+		// The recording back-end allocates IDs sequentially in the same order as it records calls
+		if (recorded != _ids.size())
+		{
+			_failed = true;
+			return;
+		}
+
+		_ids.push_back(id);
+	}
+
+	type read_type()
+	{
+		const uint32_t word = read();
+
+		type type;
+		type.base = static_cast<type::datatype>(word & 0xFF);
+		type.rows = static_cast<uint8_t>((word >> 8) & 0xFF);
+		type.cols = static_cast<uint8_t>((word >> 16) & 0xFF);
+		if (word & (1u << 24))
+			type.qualifiers = read();
+		if (word & (1u << 25))
+			type.array_length = static_cast<int>(read());
+		if (word & (1u << 26))
+			type.definition = read_id();
+		return type;
+	}
+	location read_location()
+	{
+		location loc;
+		loc.source_id = read();
+		loc.line = read();
+		loc.column = read();
+
+		if (loc.source_id >= _num_sources)
+		{
+			_failed = true;
+			loc.source_id = 0;
+		}
+		return loc;
+	}
+	constant read_constant()
+	{
+		const uint32_t word = read();
+		const uint32_t num_words = word & 0xFF;
+
+		constant data = {};
+		if (num_words > 16)
+		{
+			_failed = true;
+			return data;
+		}
+		for (uint32_t i = 0; i < num_words; ++i)
+			data.as_uint[i] = read();
+
+		if (word & (1u << 8))
+			data.string_data = read_string();
+		if (word & (1u << 9))
+		{
+			std::vector<constant> elements(read_count());
+			for (constant &element : elements)
+				element = read_constant();
+			data.array_data = std::move(elements);
+		}
+		return data;
+	}
+	expression read_expression()
+	{
+		expression exp;
+		exp.base = read_id();
+		exp.type = read_type();
+
+		const uint32_t flags = read();
+		exp.is_lvalue = (flags & 1) != 0;
+		exp.is_constant = (flags & 2) != 0;
+		if (exp.is_constant)
+			exp.constant = read_constant();
+		exp.location = read_location();
+
+		exp.chain.resize(read_count());
+		for (expression::operation &op : exp.chain)
+		{
+			op.op = static_cast<expression::operation::op_type>(read());
+			op.from = read_type();
+			op.to = read_type();
+			// Only dynamic indices refer to an ID, all other operations store a literal
+			op.index = op.op == expression::operation::op_dynamic_index ? read_id() : read();
+
+			const uint32_t swizzle = read();
+			std::memcpy(op.swizzle, &swizzle, sizeof(swizzle));
+		}
+		return exp;
+	}
+	std::pmr::vector<expression> read_expressions()
+	{
+		std::pmr::vector<expression> args(_backend->arena());
+		args.resize(read_count());
+		for (expression &arg : args)
+			arg = read_expression();
+		return args;
+	}
+	std::vector<annotation> read_annotations()
+	{
+		std::vector<annotation> annotations(read_count());
+		for (annotation &annotation : annotations)
+		{
+			annotation.type = read_type();
+			annotation.name = read_string();
+			annotation.value = read_constant();
+		}
+		return annotations;
+	}
+	struct_member_info read_member()
+	{
+		struct_member_info member;
+		member.type = read_type();
+		member.name = read_string();
+		member.semantic = read_string();
+		member.location = read_location();
+		return member;
+	}
+	pass_info read_pass()
+	{
+		pass_info pass;
+		pass.name = read_string();
+		for (std::string &name : pass.render_target_names)
+			name = read_string();
+		pass.vs_entry_point = read_entry_point_name();
+		pass.ps_entry_point = read_entry_point_name();
+		pass.cs_entry_point = read_entry_point_name();
+		pass.clear_render_targets = static_cast<uint8_t>(read());
+		pass.srgb_write_enable = static_cast<uint8_t>(read());
+		pass.blend_enable = static_cast<uint8_t>(read());
+		pass.stencil_enable = static_cast<uint8_t>(read());
+		pass.color_write_mask = static_cast<uint8_t>(read());
+		pass.stencil_read_mask = static_cast<uint8_t>(read());
+		pass.stencil_write_mask = static_cast<uint8_t>(read());
+		pass.blend_op = static_cast<pass_blend_op>(read());
+		pass.blend_op_alpha = static_cast<pass_blend_op>(read());
+		pass.src_blend = static_cast<pass_blend_func>(read());
+		pass.dest_blend = static_cast<pass_blend_func>(read());
+		pass.src_blend_alpha = static_cast<pass_blend_func>(read());
+		pass.dest_blend_alpha = static_cast<pass_blend_func>(read());
+		pass.stencil_comparison_func = static_cast<pass_stencil_func>(read());
+		pass.stencil_reference_value = read();
+		pass.stencil_op_pass = static_cast<pass_stencil_op>(read());
+		pass.stencil_op_fail = static_cast<pass_stencil_op>(read());
+		pass.stencil_op_depth_fail = static_cast<pass_stencil_op>(read());
+		pass.num_vertices = read();
+		pass.topology = static_cast<primitive_topology>(read());
+		pass.viewport_width = read();
+		pass.viewport_height = read();
+		pass.viewport_dispatch_z = read();
+
+		pass.samplers.resize(read_count());
+		for (sampler_info &info : pass.samplers)
+			if (const codegen::id id = read_id(); !_failed)
+				info = _backend->find_sampler(id);
+		pass.storages.resize(read_count());
+		for (storage_info &info : pass.storages)
+			if (const codegen::id id = read_id(); !_failed)
+				info = _backend->find_storage(id);
+		return pass;
+	}
+	std::string read_entry_point_name()
+	{
+		std::string name = read_string();
+		if (const auto it = _entry_point_names.find(name); it != _entry_point_names.end())
+			name = it->second;
+		return name;
+	}
+
+	void replay_call()
+	{
+		switch (static_cast<ir_op>(read()))
+		{
+		case ir_op::define_struct:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			struct_info info;
+			info.name = read_string();
+			info.unique_name = read_string();
+			info.member_list.resize(read_count());
+			for (struct_member_info &member : info.member_list)
+				member = read_member();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->define_struct(loc, info));
+			break;
+		}
+		case ir_op::define_texture:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			texture_info info;
+			info.semantic = read_string();
+			info.unique_name = read_string();
+			info.annotations = read_annotations();
+			info.width = read();
+			info.height = read();
+			info.levels = read();
+			info.format = static_cast<texture_format>(read());
+			const uint32_t flags = read();
+			info.render_target = (flags & 1) != 0;
+			info.storage_access = (flags & 2) != 0;
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->define_texture(loc, info));
+			break;
+		}
+		case ir_op::define_sampler:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			sampler_info info;
+			info.unique_name = read_string();
+			info.texture_name = read_string();
+			info.annotations = read_annotations();
+			info.filter = static_cast<texture_filter>(read());
+			info.address_u = static_cast<texture_address_mode>(read());
+			info.address_v = static_cast<texture_address_mode>(read());
+			info.address_w = static_cast<texture_address_mode>(read());
+			info.min_lod = read_float();
+			info.max_lod = read_float();
+			info.lod_bias = read_float();
+			info.srgb = static_cast<uint8_t>(read());
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->define_sampler(loc, info));
+			break;
+		}
+		case ir_op::define_storage:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			storage_info info;
+			info.unique_name = read_string();
+			info.texture_name = read_string();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->define_storage(loc, info));
+			break;
+		}
+		case ir_op::define_uniform:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			uniform_info info;
+			info.name = read_string();
+			info.type = read_type();
+			info.annotations = read_annotations();
+			info.has_initializer_value = read() != 0;
+			if (info.has_initializer_value)
+				info.initializer_value = read_constant();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->define_uniform(loc, info));
+			break;
+		}
+		case ir_op::define_variable:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const type type = read_type();
+			std::string name = read_string();
+			const bool global = read() != 0;
+			const codegen::id initializer_value = read_id();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->define_variable(loc, type, std::move(name), global, initializer_value));
+			break;
+		}
+		case ir_op::define_function:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			function_info info;
+			info.name = read_string();
+			info.unique_name = read_string();
+			info.return_type = read_type();
+			info.return_semantic = read_string();
+			std::vector<codegen::id> recorded_params(read_count());
+			info.parameter_list.resize(recorded_params.size());
+			for (size_t i = 0; i < recorded_params.size(); ++i)
+			{
+				recorded_params[i] = read();
+				info.parameter_list[i] = read_member();
+			}
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->define_function(loc, info));
+			for (size_t i = 0; i < recorded_params.size(); ++i)
+				bind_id(recorded_params[i], info.parameter_list[i].definition);
+			break;
+		}
+		case ir_op::define_entry_point:
+		{
+			const codegen::id function = read_id();
+			const auto stype = static_cast<shader_type>(read());
+			int num_threads[3] = {};
+			if (stype == shader_type::cs)
+				for (int &count : num_threads)
+					count = static_cast<int>(read());
+			std::string recorded_name = read_string();
+			if (_failed)
+				break;
+			function_info info = _backend->find_function(function);
+			_backend->define_entry_point(info, stype, num_threads);
+			_entry_point_names[std::move(recorded_name)] = info.unique_name;
+			break;
+		}
+		case ir_op::emit_load:
+		{
+			const codegen::id recorded = read();
+			const expression exp = read_expression();
+			const bool force_new_id = read() != 0;
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_load(exp, force_new_id));
+			break;
+		}
+		case ir_op::emit_store:
+		{
+			const expression exp = read_expression();
+			const codegen::id value = read_id();
+			if (_failed)
+				break;
+			_backend->emit_store(exp, value);
+			break;
+		}
+		case ir_op::emit_access_chain:
+		{
+			const codegen::id recorded = read();
+			const expression exp = read_expression();
+			if (_failed)
+				break;
+			size_t chain_index = 0;
+			bind_id(recorded, _backend->emit_access_chain(exp, chain_index));
+			break;
+		}
+		case ir_op::emit_constant:
+		{
+			const codegen::id recorded = read();
+			const type type = read_type();
+			const constant data = read_constant();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_constant(type, data));
+			break;
+		}
+		case ir_op::emit_unary_op:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const auto op = static_cast<tokenid>(read());
+			const type type = read_type();
+			const codegen::id val = read_id();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_unary_op(loc, op, type, val));
+			break;
+		}
+		case ir_op::emit_binary_op:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const auto op = static_cast<tokenid>(read());
+			const type res_type = read_type();
+			const type type = read_type();
+			const codegen::id lhs = read_id();
+			const codegen::id rhs = read_id();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_binary_op(loc, op, res_type, type, lhs, rhs));
+			break;
+		}
+		case ir_op::emit_ternary_op:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const auto op = static_cast<tokenid>(read());
+			const type type = read_type();
+			const codegen::id condition = read_id();
+			const codegen::id true_value = read_id();
+			const codegen::id false_value = read_id();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_ternary_op(loc, op, type, condition, true_value, false_value));
+			break;
+		}
+		case ir_op::emit_call:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const codegen::id function = read_id();
+			const type res_type = read_type();
+			const std::pmr::vector<expression> args = read_expressions();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_call(loc, function, res_type, args));
+			break;
+		}
+		case ir_op::emit_call_intrinsic:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const codegen::id intrinsic = read(); // Intrinsic index, not an ID
+			const type res_type = read_type();
+			const std::pmr::vector<expression> args = read_expressions();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_call_intrinsic(loc, intrinsic, res_type, args));
+			break;
+		}
+		case ir_op::emit_construct:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const type type = read_type();
+			const std::pmr::vector<expression> args = read_expressions();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_construct(loc, type, args));
+			break;
+		}
+		case ir_op::emit_if:
+		{
+			const location loc = read_location();
+			const codegen::id condition_value = read_id();
+			const codegen::id condition_block = read_id();
+			const codegen::id true_statement_block = read_id();
+			const codegen::id false_statement_block = read_id();
+			const uint32_t flags = read();
+			if (_failed)
+				break;
+			_backend->emit_if(loc, condition_value, condition_block, true_statement_block, false_statement_block, flags);
+			break;
+		}
+		case ir_op::emit_phi:
+		{
+			const codegen::id recorded = read();
+			const location loc = read_location();
+			const codegen::id condition_value = read_id();
+			const codegen::id condition_block = read_id();
+			const codegen::id true_value = read_id();
+			const codegen::id true_statement_block = read_id();
+			const codegen::id false_value = read_id();
+			const codegen::id false_statement_block = read_id();
+			const type type = read_type();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->emit_phi(loc, condition_value, condition_block, true_value, true_statement_block, false_value, false_statement_block, type));
+			break;
+		}
+		case ir_op::emit_loop:
+		{
+			const location loc = read_location();
+			const codegen::id condition_value = read_id();
+			const codegen::id prev_block = read_id();
+			const codegen::id header_block = read_id();
+			const codegen::id condition_block = read_id();
+			const codegen::id loop_block = read_id();
+			const codegen::id continue_block = read_id();
+			const uint32_t flags = read();
+			if (_failed)
+				break;
+			_backend->emit_loop(loc, condition_value, prev_block, header_block, condition_block, loop_block, continue_block, flags);
+			break;
+		}
+		case ir_op::emit_switch:
+		{
+			const location loc = read_location();
+			const codegen::id selector_value = read_id();
+			const codegen::id selector_block = read_id();
+			const codegen::id default_label = read_id();
+			const codegen::id default_block = read_id();
+			// Case literals and labels alternate, only the labels are IDs
+			std::vector<codegen::id> case_literal_and_labels(read_count());
+			for (size_t i = 0; i < case_literal_and_labels.size(); ++i)
+				case_literal_and_labels[i] = (i % 2) != 0 ? read_id() : read();
+			std::vector<codegen::id> case_blocks(read_count());
+			for (codegen::id &block : case_blocks)
+				block = read_id();
+			const uint32_t flags = read();
+			if (_failed)
+				break;
+			_backend->emit_switch(loc, selector_value, selector_block, default_label, default_block, case_literal_and_labels, case_blocks, flags);
+			break;
+		}
+		case ir_op::create_block:
+		{
+			const codegen::id recorded = read();
+			if (_failed)
+				break;
+			bind_id(recorded, _backend->create_block());
+			break;
+		}
+		case ir_op::set_block:
+			if (const codegen::id id = read_id(); !_failed)
+				_backend->set_block(id);
+			break;
+		case ir_op::enter_block:
+			if (const codegen::id id = read_id(); !_failed)
+				_backend->enter_block(id);
+			break;
+		case ir_op::leave_block_and_kill:
+			_backend->leave_block_and_kill();
+			break;
+		case ir_op::leave_block_and_return:
+			if (const codegen::id value = read_id(); !_failed)
+				_backend->leave_block_and_return(value);
+			break;
+		case ir_op::leave_block_and_switch:
+		{
+			const codegen::id value = read_id();
+			const codegen::id default_target = read_id();
+			if (_failed)
+				break;
+			_backend->leave_block_and_switch(value, default_target);
+			break;
+		}
+		case ir_op::leave_block_and_branch:
+		{
+			const codegen::id target = read_id();
+			const uint32_t loop_flow = read();
+			if (_failed)
+				break;
+			_backend->leave_block_and_branch(target, loop_flow);
+			break;
+		}
+		case ir_op::leave_block_and_branch_conditional:
+		{
+			const codegen::id condition = read_id();
+			const codegen::id true_target = read_id();
+			const codegen::id false_target = read_id();
+			if (_failed)
+				break;
+			_backend->leave_block_and_branch_conditional(condition, true_target, false_target);
+			break;
+		}
+		case ir_op::leave_function:
+			_backend->leave_function();
+			break;
+		case ir_op::update_texture:
+		{
+			const codegen::id id = read_id();
+			const uint32_t flags = read();
+			if (_failed)
+				break;
+			texture_info &info = _backend->find_texture(id);
+			info.render_target = (flags & 1) != 0;
+			info.storage_access = (flags & 2) != 0;
+			break;
+		}
+		case ir_op::define_technique:
+		{
+			technique_info info;
+			info.name = read_string();
+			info.annotations = read_annotations();
+			info.passes.resize(read_count());
+			for (pass_info &pass : info.passes)
+				pass = read_pass();
+			if (_failed)
+				break;
+			_backend->define_technique(info);
+			break;
+		}
+		default:
+			_failed = true;
+			break;
+		}
+	}
+
+	const std::vector<uint32_t> &_words;
+	size_t _offset = 0;
+	bool _failed = false;
+	codegen *const _backend;
+	source_table _sources;
+	uint32_t _num_sources = 1;
+	std::vector<codegen::id> _ids = { 0 }; // Maps recorded IDs to the IDs of the actual back-end
+	std::unordered_map<std::string, std::string> _entry_point_names;
+};
+
+bool reshadefx::replay_codegen_ir(const std::vector<uint32_t> &ir, codegen *backend)
+{
+	return codegen_ir_replayer(ir, backend).replay();
+}
@@ -19,25 +19,39 @@ namespace spv {
 using namespace reshadefx;
 
 /// <summary>
-/// A single instruction in a SPIR-V module
+/// A single instruction in a SPIR-V module, which refers to its encoded words in the basic block it was added to.
+/// Operands can only be added while this is the last instruction in that block.
 /// </summary>
 struct spirv_instruction
 {
-	spv::Op op;
+	// See https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html
+	// 0             | Opcode: The 16 high-order bits are the WordCount of the instruction. The 16 low-order bits are the opcode enumerant.
+	// 1             | Optional instruction type <id>
+	// .             | Optional instruction Result <id>
+	// .             | Operand 1 (if needed)
+	// .             | Operand 2 (if needed)
+	// ...           | ...
+	// WordCount - 1 | Operand N (N is determined by WordCount minus the 1 to 3 words used for the opcode, instruction type <id>, and instruction Result <id>).
+
+	std::vector<uint32_t> *words; // Word stream of the basic block containing this instruction
+	size_t offset; // Offset of the first word of this instruction in that word stream
 	spv::Id type;
 	spv::Id result;
-	std::vector<spv::Id> operands;
 
-	explicit spirv_instruction(spv::Op op = spv::OpNop) : op(op), type(0), result(0) {}
-	spirv_instruction(spv::Op op, spv::Id result) : op(op), type(result), result(0) {}
-	spirv_instruction(spv::Op op, spv::Id type, spv::Id result) : op(op), type(type), result(result) {}
+	spv::Op op() const { return static_cast<spv::Op>((*words)[offset] & spv::OpCodeMask); }
+
+	size_t num_operands() const { return ((*words)[offset] >> spv::WordCountShift) - (1 + (type != 0) + (result != 0)); }
+	spv::Id operand(size_t index) const { return (*words)[offset + 1 + (type != 0) + (result != 0) + index]; }
 
 	/// <summary>
 	/// Add a single operand to the instruction.
 	/// </summary>
 	spirv_instruction &add(spv::Id operand)
 	{
-		operands.push_back(operand);
+		assert(offset + ((*words)[offset] >> spv::WordCountShift) == words->size());
+
+		words->push_back(operand);
+		(*words)[offset] += 1 << spv::WordCountShift;
 		return *this;
 	}
 
@@ -47,7 +61,10 @@ struct spirv_instruction
 	template <typename It>
 	spirv_instruction &add(It begin, It end)
 	{
-		operands.insert(operands.end(), begin, end);
+		assert(offset + ((*words)[offset] >> spv::WordCountShift) == words->size());
+
+		words->insert(words->end(), begin, end);
+		(*words)[offset] += static_cast<uint32_t>(std::distance(begin, end)) << spv::WordCountShift;
 		return *this;
 	}
 
@@ -65,54 +82,98 @@ struct spirv_instruction
 		} while (*string || (word & 0xFF000000));
 		return *this;
 	}
+};
+
+/// <summary>
+/// A list of instructions forming a basic block in the SPIR-V module, encoded into a contiguous word stream exactly like in the final module
+/// </summary>
+struct spirv_basic_block
+{
+	std::vector<uint32_t> words;
+	size_t last_offset = 0; // Offset of the last instruction in the word stream
+
+	bool empty() const { return words.empty(); }
+
+	spv::Op last_op() const { return static_cast<spv::Op>(words[last_offset] & spv::OpCodeMask); }
 
 	/// <summary>
-	/// Write this instruction to a SPIR-V module.
+	/// Add a new instruction to the end of this basic block.
 	/// </summary>
-	/// <param name="output">The output stream to append this instruction to.</param>
-	void write(std::vector<uint32_t> &output) const
+	/// <param name="op">The opcode of the instruction.</param>
+	/// <param name="type">The result type ID of the instruction, or zero if it has none.</param>
+	/// <param name="result">The result ID of the instruction, or zero if it has none.</param>
+	spirv_instruction add_instruction(spv::Op op, spv::Id type = 0, spv::Id result = 0)
 	{
-		// See https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html
-		// 0             | Opcode: The 16 high-order bits are the WordCount of the instruction. The 16 low-order bits are the opcode enumerant.
-		// 1             | Optional instruction type <id>
-		// .             | Optional instruction Result <id>
-		// .             | Operand 1 (if needed)
-		// .             | Operand 2 (if needed)
-		// ...           | ...
-		// WordCount - 1 | Operand N (N is determined by WordCount minus the 1 to 3 words used for the opcode, instruction type <id>, and instruction Result <id>).
-
-		const uint32_t num_words = 1 + (type != 0) + (result != 0) + static_cast<uint32_t>(operands.size());
-		output.push_back((num_words << spv::WordCountShift) | op);
+		last_offset = words.size();
 
+		words.push_back(((1u + (type != 0) + (result != 0)) << spv::WordCountShift) | op);
 		// Optional instruction type ID
 		if (type != 0)
-			output.push_back(type);
-
+			words.push_back(type);
 		// Optional instruction result ID
 		if (result != 0)
-			output.push_back(result);
+			words.push_back(result);
 
-		// Write out the operands
-		output.insert(output.end(), operands.begin(), operands.end());
+		return { &words, last_offset, type, result };
 	}
-};
 
-/// <summary>
-/// A list of instructions forming a basic block in the SPIR-V module
-/// </summary>
-struct spirv_basic_block
-{
-	std::vector<spirv_instruction> instructions;
+	/// <summary>
+	/// Remove the last instruction from this basic block and return it as a basic block of its own.
+	/// This can only be called once before another instruction or block is added, since the offset of the previous instruction is not known.
+	/// </summary>
+	spirv_basic_block pop_back()
+	{
+		assert(last_offset < words.size());
+
+		spirv_basic_block block;
+		block.words.assign(words.begin() + last_offset, words.end());
+		words.resize(last_offset);
+		last_offset = words.size();
+		return block;
+	}
 
 	/// <summary>
-	/// Append another basic block the end of this one.
+	/// Move the instructions of another basic block to the end of this one, leaving the other one empty.
 	/// </summary>
-	void append(const spirv_basic_block &block)
+	void append(spirv_basic_block &&block)
 	{
-		instructions.insert(instructions.end(), block.instructions.begin(), block.instructions.end());
+		if (block.empty())
+			return;
+
+		if (words.empty())
+		{
+			words = std::move(block.words);
+			last_offset = block.last_offset;
+		}
+		else
+		{
+			last_offset = words.size() + block.last_offset;
+			words.insert(words.end(), block.words.begin(), block.words.end());
+		}
+
+		block.words.clear();
+		block.last_offset = 0;
 	}
 };
 
+/// <summary>
+/// Mix the specified <paramref name="value"/> into the hash <paramref name="seed"/>.
+/// </summary>
+static inline void hash_combine(size_t &seed, size_t value)
+{
+	seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+/// <summary>
+/// Hash all the properties of a type that are compared by its equality operator (so not the qualifiers).
+/// </summary>
+static size_t hash_type(const type &type)
+{
+	size_t seed = type.base | (type.rows << 8) | (type.cols << 16);
+	hash_combine(seed, static_cast<size_t>(type.array_length));
+	hash_combine(seed, type.definition);
+	return seed;
+}
+
 class codegen_spirv final : public codegen
 {
 public:
@@ -134,16 +195,65 @@ private:
 		{
 			return lhs.type == rhs.type && lhs.is_ptr == rhs.is_ptr && lhs.array_stride == rhs.array_stride && lhs.storage == rhs.storage;
 		}
+
+		struct hash
+		{
+			size_t operator()(const type_lookup &lookup) const
+			{
+				size_t seed = hash_type(lookup.type);
+				hash_combine(seed, lookup.is_ptr | (static_cast<size_t>(lookup.storage) << 1));
+				hash_combine(seed, lookup.array_stride);
+				return seed;
+			}
+		};
 	};
-	struct function_blocks
+	struct constant_lookup
 	{
-		spirv_basic_block declaration;
-		spirv_basic_block variables;
-		spirv_basic_block definition;
-		type return_type;
-		std::vector<type> param_types;
+		reshadefx::type type;
+		reshadefx::constant data;
 
-		friend bool operator==(const function_blocks &lhs, const function_blocks &rhs)
+		// Only compares the inline data of the constant and its array elements, since string constants and nested arrays are never emitted
+		friend bool operator==(const constant_lookup &lhs, const constant_lookup &rhs)
+		{
+			if (!(lhs.type == rhs.type && std::memcmp(&lhs.data.as_uint[0], &rhs.data.as_uint[0], sizeof(uint32_t) * 16) == 0 && lhs.data.array_data->size() == rhs.data.array_data->size()))
+				return false;
+			// Copies of the same array constant share their elements, so can skip comparing them one by one
+			if (&*lhs.data.array_data == &*rhs.data.array_data)
+				return true;
+			for (size_t i = 0; i < lhs.data.array_data->size(); ++i)
+				if (std::memcmp(&(*lhs.data.array_data)[i].as_uint[0], &(*rhs.data.array_data)[i].as_uint[0], sizeof(uint32_t) * 16) != 0)
+					return false;
+			return true;
+		}
+
+		struct hash
+		{
+			static void hash_data(size_t &seed, const reshadefx::constant &data)
+			{
+				for (size_t i = 0; i < 16; ++i)
+					hash_combine(seed, data.as_uint[i]);
+			}
+
+			size_t operator()(const constant_lookup &lookup) const
+			{
+				size_t seed = hash_type(lookup.type);
+				hash_data(seed, lookup.data);
+
+				// Only hash a bounded number of evenly spaced elements of large arrays, so that looking up big constant tables stays cheap (equality still compares all of them)
+				const std::vector<reshadefx::constant> &elements = *lookup.data.array_data;
+				const size_t step = elements.size() / 16 + 1;
+				for (size_t i = 0; i < elements.size(); i += step)
+					hash_data(seed, elements[i]);
+				return seed;
+			}
+		};
+	};
+	struct function_type_lookup
+	{
+		reshadefx::type return_type;
+		std::vector<reshadefx::type> param_types;
+
+		friend bool operator==(const function_type_lookup &lhs, const function_type_lookup &rhs)
 		{
 			if (lhs.param_types.size() != rhs.param_types.size())
 				return false;
@@ -152,6 +262,25 @@ private:
 					return false;
 			return lhs.return_type == rhs.return_type;
 		}
+
+		struct hash
+		{
+			size_t operator()(const function_type_lookup &lookup) const
+			{
+				size_t seed = hash_type(lookup.return_type);
+				for (const reshadefx::type &param_type : lookup.param_types)
+					hash_combine(seed, hash_type(param_type));
+				return seed;
+			}
+		};
+	};
+	struct function_blocks
+	{
+		spirv_basic_block declaration;
+		spirv_basic_block variables;
+		spirv_basic_block definition;
+		type return_type;
+		std::vector<type> param_types;
 	};
 
 	spirv_basic_block _entries;
@@ -162,12 +291,12 @@ private:
 	spirv_basic_block _types_and_constants;
 	spirv_basic_block _variables;
 
-	std::unordered_set<spv::Id> _spec_constants;
+	std::unordered_map<spv::Id, size_t> _spec_constants; // Result ID to offset of the defining instruction in the types and constants block
 	std::unordered_set<spv::Capability> _capabilities;
-	std::vector<std::pair<type_lookup, spv::Id>> _type_lookup;
-	std::vector<std::tuple<type, constant, spv::Id>> _constant_lookup;
-	std::vector<std::pair<function_blocks, spv::Id>> _function_type_lookup;
-	std::unordered_map<std::string, spv::Id> _string_lookup;
+	std::unordered_map<type_lookup, spv::Id, type_lookup::hash> _type_lookup;
+	std::unordered_map<constant_lookup, spv::Id, constant_lookup::hash> _constant_lookup;
+	std::unordered_map<function_type_lookup, spv::Id, function_type_lookup::hash> _function_type_lookup;
+	std::unordered_map<uint32_t, spv::Id> _string_lookup;
 	std::unordered_map<spv::Id, spv::StorageClass> _storage_lookup;
 	std::unordered_map<std::string, uint32_t> _semantic_to_location;
 
@@ -188,11 +317,11 @@ private:
 
 	inline void add_location(const location &loc, spirv_basic_block &block)
 	{
-		if (loc.source.empty() || !_debug_info)
+		if (loc.source_id == 0 || _sources == nullptr || !_debug_info)
 			return;
 
 		spv::Id file;
-		if (const auto it = _string_lookup.find(loc.source);
+		if (const auto it = _string_lookup.find(loc.source_id);
 			it != _string_lookup.end())
 		{
 			file = it->second;
@@ -200,8 +329,8 @@ private:
 		else
 		{
 			add_instruction(spv::OpString, 0, _debug_a, file)
-				.add_string(loc.source.c_str());
-			_string_lookup.emplace(loc.source, file);
+				.add_string((*_sources)[loc].c_str());
+			_string_lookup.emplace(loc.source_id, file);
 		}
 
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpLine
@@ -210,33 +339,44 @@ private:
 			.add(loc.line)
 			.add(loc.column);
 	}
-	inline spirv_instruction &add_instruction(spv::Op op, spv::Id type = 0)
+	inline spirv_instruction add_instruction(spv::Op op, spv::Id type = 0)
 	{
 		assert(is_in_function() && is_in_block());
 		return add_instruction(op, type, *_current_block_data);
 	}
-	inline spirv_instruction &add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block)
+	inline spirv_instruction add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block)
 	{
-		spirv_instruction &instruction = add_instruction_without_result(op, block);
-		instruction.type = type;
-		instruction.result = make_id();
-		return instruction;
+		return block.add_instruction(op, type, make_id());
 	}
-	inline spirv_instruction &add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block, spv::Id &result)
+	inline spirv_instruction add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block, spv::Id &result)
 	{
-		spirv_instruction &instruction = add_instruction_without_result(op, block);
-		instruction.type = type;
-		instruction.result = result = make_id();
-		return instruction;
+		return block.add_instruction(op, type, result = make_id());
 	}
-	inline spirv_instruction &add_instruction_without_result(spv::Op op)
+	inline spirv_instruction add_instruction_without_result(spv::Op op)
 	{
 		assert(is_in_function() && is_in_block());
 		return add_instruction_without_result(op, *_current_block_data);
 	}
-	inline spirv_instruction &add_instruction_without_result(spv::Op op, spirv_basic_block &block)
+	inline spirv_instruction add_instruction_without_result(spv::Op op, spirv_basic_block &block)
 	{
-		return block.instructions.emplace_back(op);
+		return block.add_instruction(op);
+	}
+
+	/// <summary>
+	/// Remove the basic block with the specified ID from the list of pending blocks, so that it can be merged into another one.
+	/// </summary>
+	spirv_basic_block take_block(id id)
+	{
+		assert(id != _current_block);
+
+		spirv_basic_block block;
+		if (const auto it = _block_data.find(id);
+			it != _block_data.end())
+		{
+			block = std::move(it->second);
+			_block_data.erase(it);
+		}
+		return block;
 	}
 
 	void write_result(module &module) override
@@ -244,16 +384,14 @@ private:
 		// First initialize the UBO type now that all member types are known
 		if (_global_ubo_type != 0)
 		{
-			spirv_instruction &type_inst = add_instruction_without_result(spv::OpTypeStruct, _types_and_constants);
-			type_inst.add(_global_ubo_types.begin(), _global_ubo_types.end());
-			type_inst.result = _global_ubo_type;
+			_types_and_constants.add_instruction(spv::OpTypeStruct, 0, _global_ubo_type)
+				.add(_global_ubo_types.begin(), _global_ubo_types.end());
 
-			spirv_instruction &variable_inst = add_instruction_without_result(spv::OpVariable, _variables);
-			variable_inst.add(spv::StorageClassUniform);
-			variable_inst.type = convert_type({ type::t_struct, 0, 0, type::q_uniform, 0, _global_ubo_type }, true, spv::StorageClassUniform);
-			variable_inst.result = _global_ubo_variable;
+			const spv::Id variable_type = convert_type({ type::t_struct, 0, 0, type::q_uniform, 0, _global_ubo_type }, true, spv::StorageClassUniform);
+			_variables.add_instruction(spv::OpVariable, variable_type, _global_ubo_variable)
+				.add(spv::StorageClassUniform);
 
-			add_name(variable_inst.result, "$Globals");
+			add_name(_global_ubo_variable, "$Globals");
 		}
 
 		module = std::move(_module);
@@ -265,76 +403,70 @@ private:
 		module.spirv.push_back(_next_id); // Maximum ID
 		module.spirv.push_back(0u); // Reserved for instruction schema
 
+		spirv_basic_block header;
+
 		// All capabilities
-		spirv_instruction(spv::OpCapability)
-			.add(spv::CapabilityShader) // Implicitly declares the Matrix capability too
-			.write(module.spirv);
+		header.add_instruction(spv::OpCapability)
+			.add(spv::CapabilityShader); // Implicitly declares the Matrix capability too
 
 		for (spv::Capability capability : _capabilities)
-			spirv_instruction(spv::OpCapability)
-				.add(capability)
-				.write(module.spirv);
+			header.add_instruction(spv::OpCapability)
+				.add(capability);
 
 		// Optional extension instructions
-		spirv_instruction(spv::OpExtInstImport, _glsl_ext)
-			.add_string("GLSL.std.450") // Import GLSL extension
-			.write(module.spirv);
+		header.add_instruction(spv::OpExtInstImport, 0, _glsl_ext)
+			.add_string("GLSL.std.450"); // Import GLSL extension
 
 		// Single required memory model instruction
-		spirv_instruction(spv::OpMemoryModel)
+		header.add_instruction(spv::OpMemoryModel)
 			.add(spv::AddressingModelLogical)
-			.add(spv::MemoryModelGLSL450)
-			.write(module.spirv);
+			.add(spv::MemoryModelGLSL450);
 
 		// All entry point declarations
-		for (const auto &node : _entries.instructions)
-			node.write(module.spirv);
+		header.append(std::move(_entries));
 
 		// All execution mode declarations
-		for (const auto &node : _execution_modes.instructions)
-			node.write(module.spirv);
+		header.append(std::move(_execution_modes));
 
-		spirv_instruction(spv::OpSource)
+		header.add_instruction(spv::OpSource)
 			.add(spv::SourceLanguageUnknown) // ReShade FX is not a reserved token at the moment
-			.add(0) // Language version, TODO: Maybe fill in ReShade version here?
-			.write(module.spirv);
+			.add(0); // Language version, TODO: Maybe fill in ReShade version here?
+
+		// Basic blocks are already encoded, so writing them out only has to concatenate the word streams
+		const auto write_block = [&module](const spirv_basic_block &block) {
+			module.spirv.insert(module.spirv.end(), block.words.begin(), block.words.end());
+		};
+
+		write_block(header);
 
 		if (_debug_info)
 		{
 			// All debug instructions
-			for (const auto &node : _debug_a.instructions)
-				node.write(module.spirv);
-			for (const auto &node : _debug_b.instructions)
-				node.write(module.spirv);
+			write_block(_debug_a);
+			write_block(_debug_b);
 		}
 
 		// All annotation instructions
-		for (const auto &node : _annotations.instructions)
-			node.write(module.spirv);
+		write_block(_annotations);
 
 		// All type declarations
-		for (const auto &node : _types_and_constants.instructions)
-			node.write(module.spirv);
-		for (const auto &node : _variables.instructions)
-			node.write(module.spirv);
+		write_block(_types_and_constants);
+		write_block(_variables);
 
 		// All function definitions
-		for (const auto &function : _functions_blocks)
+		for (const function_blocks &function : _functions_blocks)
 		{
-			if (function.definition.instructions.empty())
+			if (function.definition.empty())
 				continue;
 
-			for (const auto &node : function.declaration.instructions)
-				node.write(module.spirv);
+			write_block(function.declaration);
 
 			// Grab first label and move it in front of variable declarations
-			function.definition.instructions.front().write(module.spirv);
-			assert(function.definition.instructions.front().op == spv::OpLabel);
+			assert(function.definition.words[0] == ((2u << spv::WordCountShift) | spv::OpLabel));
+			module.spirv.insert(module.spirv.end(), function.definition.words.begin(), function.definition.words.begin() + 2);
 
-			for (const auto &node : function.variables.instructions)
-				node.write(module.spirv);
-			for (auto it = function.definition.instructions.begin() + 1; it != function.definition.instructions.end(); ++it)
-				it->write(module.spirv);
+			write_block(function.variables);
+			module.spirv.insert(module.spirv.end(), function.definition.words.begin() + 2, function.definition.words.end());
 		}
 	}
 
@@ -354,8 +486,8 @@ private:
 			info.base = static_cast<type::datatype>(info.base + 1); // min16int -> int, min16uint -> uint, min16float -> float
 
 		const type_lookup lookup = { info, is_ptr, array_stride, storage };
-		if (const auto it = std::find_if(_type_lookup.begin(), _type_lookup.end(),
-			[&lookup](const auto &lookup_it) { return lookup_it.first == lookup; }); it != _type_lookup.end())
+		if (const auto it = _type_lookup.find(lookup);
+			it != _type_lookup.end())
 			return it->second;
 
 		spv::Id type, elem_type;
@@ -499,14 +631,15 @@ private:
 			}
 		}
 
-		_type_lookup.push_back({ lookup, type });
+		_type_lookup.emplace(lookup, type);
 
 		return type;
 	}
 	spv::Id convert_type(const function_blocks &info)
 	{
-		if (auto it = std::find_if(_function_type_lookup.begin(), _function_type_lookup.end(),
-			[&info](const auto &lookup) { return lookup.first == info; }); it != _function_type_lookup.end())
+		function_type_lookup lookup = { info.return_type, info.param_types };
+		if (const auto it = _function_type_lookup.find(lookup);
+			it != _function_type_lookup.end())
 			return it->second;
 
 		auto return_type = convert_type(info.return_type);
@@ -517,11 +650,11 @@ private:
 		for (const type &param_type : info.param_types)
 			param_type_ids.push_back(convert_type(param_type, true));
 
-		spirv_instruction &inst = add_instruction(spv::OpTypeFunction, 0, _types_and_constants);
+		spirv_instruction inst = add_instruction(spv::OpTypeFunction, 0, _types_and_constants);
 		inst.add(return_type);
 		inst.add(param_type_ids.begin(), param_type_ids.end());
 
-		_function_type_lookup.push_back({ info, inst.result });;
+		_function_type_lookup.emplace(std::move(lookup), inst.result);
 
 		return inst.result;
 	}
@@ -711,7 +844,7 @@ private:
 			add_name(res, info.name.c_str());
 
 			const auto add_spec_constant = [this](const spirv_instruction &inst, const uniform_info &info, const constant &initializer_value, size_t initializer_offset) {
-				assert(inst.op == spv::OpSpecConstant || inst.op == spv::OpSpecConstantTrue || inst.op == spv::OpSpecConstantFalse);
+				assert(inst.op() == spv::OpSpecConstant || inst.op() == spv::OpSpecConstantTrue || inst.op() == spv::OpSpecConstantFalse);
 
 				const uint32_t spec_id = static_cast<uint32_t>(_module.spec_constants.size());
 				add_decoration(inst.result, spv::DecorationSpecId, { spec_id });
@@ -726,9 +859,14 @@ private:
 
 				_module.spec_constants.push_back(scalar_info);
 			};
+			// All specialization constants were added to the types and constants block, so can look up their instruction directly by result ID
+			const auto find_constant = [this](spv::Id result) {
+				const size_t offset = _spec_constants.at(result);
+				assert(_types_and_constants.words[offset + 2] == result);
+				return spirv_instruction { &_types_and_constants.words, offset, _types_and_constants.words[offset + 1], result };
+			};
 
-			const spirv_instruction &base_inst = _types_and_constants.instructions.back();
-			assert(base_inst.result == res);
+			const spirv_instruction base_inst = find_constant(res);
 
 			// External specialization constants need to be scalars
 			if (info.type.is_scalar())
@@ -737,38 +875,35 @@ private:
 			}
 			else
 			{
-				assert(base_inst.op == spv::OpSpecConstantComposite);
+				assert(base_inst.op() == spv::OpSpecConstantComposite);
 
 				// Add each individual scalar component of the constant as a separate external specialization constant
-				for (size_t i = 0; i < (info.type.is_array() ? base_inst.operands.size() : 1); ++i)
+				for (size_t i = 0; i < (info.type.is_array() ? base_inst.num_operands() : 1); ++i)
 				{
 					constant initializer_value = info.initializer_value;
 					spirv_instruction elem_inst = base_inst;
 
 					if (info.type.is_array())
 					{
-						elem_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-							[elem = base_inst.operands[i]](const auto &it) { return it.result == elem; });
+						elem_inst = find_constant(base_inst.operand(i));
 
-						assert(initializer_value.array_data.size() == base_inst.operands.size());
-						initializer_value = initializer_value.array_data[i];
+						assert(initializer_value.array_data->size() == base_inst.num_operands());
+						initializer_value = (*initializer_value.array_data)[i];
 					}
 
-					for (size_t row = 0; row < elem_inst.operands.size(); ++row)
+					for (size_t row = 0; row < elem_inst.num_operands(); ++row)
 					{
-						const spirv_instruction &row_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-							[elem = elem_inst.operands[row]](const auto &it) { return it.result == elem; });
+						const spirv_instruction row_inst = find_constant(elem_inst.operand(row));
 
-						if (row_inst.op != spv::OpSpecConstantComposite)
+						if (row_inst.op() != spv::OpSpecConstantComposite)
 						{
 							add_spec_constant(row_inst, info, initializer_value, row);
 							continue;
 						}
 
-						for (size_t col = 0; col < row_inst.operands.size(); ++col)
+						for (size_t col = 0; col < row_inst.num_operands(); ++col)
 						{
-							const spirv_instruction &col_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-								[elem = row_inst.operands[col]](const auto &it) { return it.result == elem; });
+							const spirv_instruction col_inst = find_constant(row_inst.operand(col));
 
 							add_spec_constant(col_inst, info, initializer_value, row * info.type.cols + col);
 						}
@@ -867,7 +1002,7 @@ private:
 
 		spv::Id res;
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpVariable
-		spirv_instruction &inst = add_instruction(spv::OpVariable, convert_type(type, true, storage), block, res)
+		spirv_instruction inst = add_instruction(spv::OpVariable, convert_type(type, true, storage), block, res)
 			.add(storage);
 
 		if (initializer_value != 0)
@@ -949,7 +1084,7 @@ private:
 
 		spv::Id position_variable = 0, point_size_variable = 0;
 		std::vector<spv::Id> inputs_and_outputs;
-		std::vector<expression> call_params;
+		std::pmr::vector<expression> call_params(arena());
 
 		// Generate the glue entry point function
 		function_info entry_point;
@@ -1268,7 +1403,10 @@ private:
 				it != _storage_lookup.end())
 				storage = it->second;
 
-			spirv_instruction *access_chain = nullptr;
+			// Access chain result ID and indices are collected first and the instruction is only added once its result type is known
+			spv::Id access_chain = 0;
+			spv::Id access_chain_base = result;
+			std::vector<spv::Id> access_chain_indices;
 
 			// Check if this is a uniform variable (see 'define_uniform' function above) and dereference it
 			if (result & 0xF0000000)
@@ -1281,9 +1419,9 @@ private:
 				if (is_uniform_bool)
 					base_type.base = type::t_uint;
 
-				access_chain = &add_instruction(spv::OpAccessChain)
-					.add(_global_ubo_variable)
-					.add(emit_constant(member_index));
+				access_chain = make_id();
+				access_chain_base = _global_ubo_variable;
+				access_chain_indices.push_back(emit_constant(member_index));
 			}
 
 			// Any indexing expressions can be resolved during load with an 'OpAccessChain' already
@@ -1292,12 +1430,9 @@ private:
 				exp.chain[0].op == expression::operation::op_dynamic_index ||
 				exp.chain[0].op == expression::operation::op_constant_index))
 			{
-				// Ensure that 'access_chain' cannot get invalidated by calls to 'emit_constant' or 'convert_type'
-				assert(_current_block_data != &_types_and_constants);
-
 				// Use access chain from uniform if possible, otherwise create new one
-				if (access_chain == nullptr) access_chain =
-					&add_instruction(spv::OpAccessChain).add(result); // Base
+				if (access_chain == 0)
+					access_chain = make_id();
 
 				// Ignore first index into 1xN matrices, since they were translated to a vector type in SPIR-V
 				if (exp.chain[0].from.rows == 1 && exp.chain[0].from.cols > 1)
@@ -1307,18 +1442,22 @@ private:
 					exp.chain[i].op == expression::operation::op_member ||
 					exp.chain[i].op == expression::operation::op_dynamic_index ||
 					exp.chain[i].op == expression::operation::op_constant_index); ++i)
-					access_chain->add(exp.chain[i].op == expression::operation::op_dynamic_index ?
+					access_chain_indices.push_back(exp.chain[i].op == expression::operation::op_dynamic_index ?
 						exp.chain[i].index :
 						emit_constant(exp.chain[i].index)); // Indexes
 
 				base_type = exp.chain[i - 1].to;
-				access_chain->type = convert_type(base_type, true, storage); // Last type is the result
-				result = access_chain->result;
+				result = _current_block_data->add_instruction(spv::OpAccessChain, convert_type(base_type, true, storage), access_chain) // Last type is the result
+					.add(access_chain_base) // Base
+					.add(access_chain_indices.begin(), access_chain_indices.end())
+					.result;
 			}
-			else if (access_chain != nullptr)
+			else if (access_chain != 0)
 			{
-				access_chain->type = convert_type(base_type, true, storage, base_type.is_array() ? 16u : 0u);
-				result = access_chain->result;
+				result = _current_block_data->add_instruction(spv::OpAccessChain, convert_type(base_type, true, storage, base_type.is_array() ? 16u : 0u), access_chain)
+					.add(access_chain_base) // Base
+					.add(access_chain_indices.begin(), access_chain_indices.end())
+					.result;
 			}
 
 			result = add_instruction(spv::OpLoad, convert_type(base_type))
@@ -1445,7 +1584,7 @@ private:
 							scalar_type.rows = 1;
 							scalar_type.cols = 1;
 
-							spirv_instruction &node = add_instruction(spv::OpCompositeExtract, convert_type(scalar_type))
+							spirv_instruction node = add_instruction(spv::OpCompositeExtract, convert_type(scalar_type))
 								.add(result);
 
 							if (op.from.rows > 1) // Matrix types with a single row are actually vectors, so they don't need the extra index
@@ -1456,7 +1595,7 @@ private:
 							components[c] = node.result;
 						}
 
-						spirv_instruction &node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
+						spirv_instruction node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
 						for (unsigned int c = 0; c < 4 && op.swizzle[c] >= 0; ++c)
 							node.add(components[c]);
 						result = node.result;
@@ -1464,7 +1603,7 @@ private:
 					}
 					else if (op.from.is_vector())
 					{
-						spirv_instruction &node = add_instruction(spv::OpVectorShuffle, convert_type(op.to))
+						spirv_instruction node = add_instruction(spv::OpVectorShuffle, convert_type(op.to))
 							.add(result) // Vector 1
 							.add(result); // Vector 2
 						for (unsigned int c = 0; c < 4 && op.swizzle[c] >= 0; ++c)
@@ -1474,7 +1613,7 @@ private:
 					}
 					else
 					{
-						spirv_instruction &node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
+						spirv_instruction node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
 						for (unsigned int c = 0; c < op.to.rows; ++c)
 							node.add(result);
 						result = node.result;
@@ -1485,7 +1624,7 @@ private:
 				{
 					assert(op.swizzle[1] < 0);
 
-					spirv_instruction &node = add_instruction(spv::OpCompositeExtract, convert_type(op.to))
+					spirv_instruction node = add_instruction(spv::OpCompositeExtract, convert_type(op.to))
 						.add(result); // Composite
 					if (op.from.rows > 1)
 					{
@@ -1542,7 +1681,7 @@ private:
 
 					if (base_type.is_vector())
 					{
-						spirv_instruction &node = add_instruction(spv::OpVectorShuffle, convert_type(base_type))
+						spirv_instruction node = add_instruction(spv::OpVectorShuffle, convert_type(base_type))
 							.add(result) // Vector 1
 							.add(value); // Vector 2
 
@@ -1559,7 +1698,7 @@ private:
 					{
 						assert(op.swizzle[1] < 0);
 
-						spirv_instruction &node = add_instruction(spv::OpCompositeInsert, convert_type(base_type))
+						spirv_instruction node = add_instruction(spv::OpCompositeInsert, convert_type(base_type))
 							.add(value) // Object
 							.add(result); // Composite
 
@@ -1608,11 +1747,9 @@ private:
 			it != _storage_lookup.end())
 			storage = it->second;
 
-		// Ensure that 'access_chain' cannot get invalidated by calls to 'emit_constant' or 'convert_type'
-		assert(_current_block_data != &_types_and_constants);
-
-		spirv_instruction *access_chain =
-			&add_instruction(spv::OpAccessChain).add(exp.base); // Base
+		// Instruction is only added once its result type is known, but the result ID is allocated before those of any index constants
+		const spv::Id access_chain = make_id();
+		std::vector<spv::Id> access_chain_indices;
 
 		// Ignore first index into 1xN matrices, since they were translated to a vector type in SPIR-V
 		if (exp.chain[0].from.rows == 1 && exp.chain[0].from.cols > 1)
@@ -1622,12 +1759,14 @@ private:
 			exp.chain[i].op == expression::operation::op_member ||
 			exp.chain[i].op == expression::operation::op_dynamic_index ||
 			exp.chain[i].op == expression::operation::op_constant_index); ++i)
-			access_chain->add(exp.chain[i].op == expression::operation::op_dynamic_index ?
+			access_chain_indices.push_back(exp.chain[i].op == expression::operation::op_dynamic_index ?
 				exp.chain[i].index :
 				emit_constant(exp.chain[i].index)); // Indexes
 
-		access_chain->type = convert_type(exp.chain[i - 1].to, true, storage); // Last type is the result
-		return access_chain->result;
+		return _current_block_data->add_instruction(spv::OpAccessChain, convert_type(exp.chain[i - 1].to, true, storage), access_chain) // Last type is the result
+			.add(exp.base) // Base
+			.add(access_chain_indices.begin(), access_chain_indices.end())
+			.result;
 	}
 
 	id   emit_constant(uint32_t value)
@@ -1653,15 +1792,9 @@ private:
 	id   emit_constant(const type &type, const constant &data, bool spec_constant)
 	{
 		if (!spec_constant) // Specialization constants cannot reuse other constants
-			if (auto it = std::find_if(_constant_lookup.begin(), _constant_lookup.end(), [&type, &data](auto &x) {
-				if (!(std::get<0>(x) == type && std::memcmp(&std::get<1>(x).as_uint[0], &data.as_uint[0], sizeof(uint32_t) * 16) == 0 && std::get<1>(x).array_data.size() == data.array_data.size()))
-					return false;
-				for (size_t i = 0; i < data.array_data.size(); ++i)
-					if (std::memcmp(&std::get<1>(x).array_data[i].as_uint[0], &data.array_data[i].as_uint[0], sizeof(uint32_t) * 16) != 0)
-						return false;
-				return true;
-			}); it != _constant_lookup.end())
-				return std::get<2>(*it); // Re-use existing constant instead of duplicating the definition
+			if (const auto it = _constant_lookup.find({ type, data });
+				it != _constant_lookup.end())
+				return it->second; // Re-use existing constant instead of duplicating the definition
 
 		spv::Id result;
 		if (type.is_array())
@@ -1675,7 +1808,7 @@ private:
 			elements.reserve(type.array_length);
 
 			// Fill up elements with constant array data
-			for (const constant &elem : data.array_data)
+			for (const constant &elem : *data.array_data)
 				elements.push_back(emit_constant(elem_type, elem, spec_constant));
 			// Fill up any remaining elements with a default value (when the array data did not specify them)
 			for (size_t i = elements.size(); i < static_cast<size_t>(type.array_length); ++i)
@@ -1717,7 +1850,7 @@ private:
 			}
 			else
 			{
-				spirv_instruction &node = add_instruction(spec_constant ? spv::OpSpecConstantComposite : spv::OpConstantComposite, convert_type(type), _types_and_constants);
+				spirv_instruction node = add_instruction(spec_constant ? spv::OpSpecConstantComposite : spv::OpConstantComposite, convert_type(type), _types_and_constants);
 				for (unsigned int i = 0; i < type.rows; ++i)
 					node.add(rows[i]);
 
@@ -1740,10 +1873,10 @@ private:
 				.result;
 		}
 
-		if (spec_constant) // Keep track of all specialization constants
-			_spec_constants.insert(result);
+		if (spec_constant) // Keep track of all specialization constants (single row matrices reuse the row vector, which is the last instruction added and already tracked)
+			_spec_constants.emplace(result, _types_and_constants.last_offset);
 		else
-			_constant_lookup.push_back({ type, data, result });
+			_constant_lookup.emplace(constant_lookup { type, data }, result);
 
 		return result;
 	}
@@ -1769,7 +1902,7 @@ private:
 
 		add_location(loc, *_current_block_data);
 
-		spirv_instruction &inst = add_instruction(spv_op, convert_type(type));
+		spirv_instruction inst = add_instruction(spv_op, convert_type(type));
 		inst.add(val); // Operand
 
 		return inst.result;
@@ -1879,7 +2012,7 @@ private:
 					.add(row)
 					.result;
 
-				spirv_instruction &inst = add_instruction(spv_op, convert_type(vector_type));
+				spirv_instruction inst = add_instruction(spv_op, convert_type(vector_type));
 				inst.add(lhs_elem); // Operand 1
 				inst.add(rhs_elem); // Operand 2
 
@@ -1891,14 +2024,14 @@ private:
 				ids.push_back(inst.result);
 			}
 
-			spirv_instruction &inst = add_instruction(spv::OpCompositeConstruct, convert_type(res_type));
+			spirv_instruction inst = add_instruction(spv::OpCompositeConstruct, convert_type(res_type));
 			inst.add(ids.begin(), ids.end());
 
 			return inst.result;
 		}
 		else
 		{
-			spirv_instruction &inst = add_instruction(spv_op, convert_type(res_type));
+			spirv_instruction inst = add_instruction(spv_op, convert_type(res_type));
 			inst.add(lhs); // Operand 1
 			inst.add(rhs); // Operand 2
 
@@ -1917,14 +2050,14 @@ private:
 
 		add_location(loc, *_current_block_data);
 
-		spirv_instruction &inst = add_instruction(spv::OpSelect, convert_type(type));
+		spirv_instruction inst = add_instruction(spv::OpSelect, convert_type(type));
 		inst.add(condition); // Condition
 		inst.add(true_value); // Object 1
 		inst.add(false_value); // Object 2
 
 		return inst.result;
 	}
-	id   emit_call(const location &loc, id function, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call(const location &loc, id function, const type &res_type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1933,14 +2066,14 @@ private:
 		add_location(loc, *_current_block_data);
 
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpFunctionCall
-		spirv_instruction &inst = add_instruction(spv::OpFunctionCall, convert_type(res_type));
+		spirv_instruction inst = add_instruction(spv::OpFunctionCall, convert_type(res_type));
 		inst.add(function); // Function
 		for (const expression &arg : args)
 			inst.add(arg.base); // Arguments
 
 		return inst.result;
 	}
-	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::vector<expression> &args) override
+	id   emit_call_intrinsic(const location &loc, id intrinsic, const type &res_type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1962,7 +2095,7 @@ private:
 			return assert(false), 0;
 		}
 	}
-	id   emit_construct(const location &loc, const type &type, const std::vector<expression> &args) override
+	id   emit_construct(const location &loc, const type &type, const std::pmr::vector<expression> &args) override
 	{
 #ifndef NDEBUG
 		for (const expression &arg : args)
@@ -1983,7 +2116,7 @@ private:
 			// Turn the list of scalar arguments into a list of column vectors
 			for (size_t arg = 0; arg < args.size(); arg += vector_type.rows)
 			{
-				spirv_instruction &inst = add_instruction(spv::OpCompositeConstruct, convert_type(vector_type));
+				spirv_instruction inst = add_instruction(spv::OpCompositeConstruct, convert_type(vector_type));
 				for (unsigned row = 0; row < vector_type.rows; ++row)
 					inst.add(args[arg + row].base);
 
@@ -1999,7 +2132,7 @@ private:
 				ids.push_back(arg.base);
 		}
 
-		spirv_instruction &inst = add_instruction(spv::OpCompositeConstruct, convert_type(type));
+		spirv_instruction inst = add_instruction(spv::OpCompositeConstruct, convert_type(type));
 		inst.add(ids.begin(), ids.end());
 
 		return inst.result;
@@ -2007,50 +2140,47 @@ private:
 
 	void emit_if(const location &loc, id, id condition_block, id true_statement_block, id false_statement_block, unsigned int selection_control) override
 	{
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->pop_back();
+		assert(merge_label.last_op() == spv::OpLabel);
 
 		// Add previous block containing the condition value first
-		_current_block_data->append(_block_data[condition_block]);
+		_current_block_data->append(take_block(condition_block));
 
-		spirv_instruction branch_inst = _current_block_data->instructions.back();
-		assert(branch_inst.op == spv::OpBranchConditional);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block branch_inst = _current_block_data->pop_back();
+		assert(branch_inst.last_op() == spv::OpBranchConditional);
 
 		// Add structured control flow instruction
 		add_location(loc, *_current_block_data);
 		add_instruction_without_result(spv::OpSelectionMerge)
-			.add(merge_label.result)
+			.add(_current_block) // Merge label is the one of the current block
 			.add(selection_control & 0x3); // 'SelectionControl' happens to match the flags produced by the parser
 
 		// Append all blocks belonging to the branch
-		_current_block_data->instructions.push_back(branch_inst);
-		_current_block_data->append(_block_data[true_statement_block]);
-		_current_block_data->append(_block_data[false_statement_block]);
+		_current_block_data->append(std::move(branch_inst));
+		_current_block_data->append(take_block(true_statement_block));
+		_current_block_data->append(take_block(false_statement_block));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 	}
 	id   emit_phi(const location &loc, id, id condition_block, id true_value, id true_statement_block, id false_value, id false_statement_block, const type &type) override
 	{
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->pop_back();
+		assert(merge_label.last_op() == spv::OpLabel);
 
 		// Add previous block containing the condition value first
-		_current_block_data->append(_block_data[condition_block]);
+		_current_block_data->append(take_block(condition_block));
 
 		if (true_statement_block != condition_block)
-			_current_block_data->append(_block_data[true_statement_block]);
+			_current_block_data->append(take_block(true_statement_block));
 		if (false_statement_block != condition_block)
-			_current_block_data->append(_block_data[false_statement_block]);
+			_current_block_data->append(take_block(false_statement_block));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 
 		add_location(loc, *_current_block_data);
 
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpPhi
-		spirv_instruction &inst = add_instruction(spv::OpPhi, convert_type(type))
+		spirv_instruction inst = add_instruction(spv::OpPhi, convert_type(type))
 			.add(true_value) // Variable 0
 			.add(true_statement_block) // Parent 0
 			.add(false_value) // Variable 1
@@ -2060,76 +2190,75 @@ private:
 	}
 	void emit_loop(const location &loc, id, id prev_block, id header_block, id condition_block, id loop_block, id continue_block, unsigned int loop_control) override
 	{
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->pop_back();
+		assert(merge_label.last_op() == spv::OpLabel);
 
 		// Add previous block first
-		_current_block_data->append(_block_data[prev_block]);
+		_current_block_data->append(take_block(prev_block));
 
 		// Fill header block
-		assert(_block_data[header_block].instructions.size() == 2);
-		_current_block_data->instructions.push_back(_block_data[header_block].instructions[0]);
-		assert(_current_block_data->instructions.back().op == spv::OpLabel);
+		spirv_basic_block header_label = take_block(header_block);
+		spirv_basic_block header_branch = header_label.pop_back();
+		assert(header_label.words.size() == 2 && (header_label.words[0] & spv::OpCodeMask) == spv::OpLabel);
+		assert(header_branch.last_op() == spv::OpBranch);
+		_current_block_data->append(std::move(header_label));
 
 		// Add structured control flow instruction
 		add_location(loc, *_current_block_data);
 		add_instruction_without_result(spv::OpLoopMerge)
-			.add(merge_label.result)
+			.add(_current_block) // Merge label is the one of the current block
 			.add(continue_block)
 			.add(loop_control & 0x3); // 'LoopControl' happens to match the flags produced by the parser
 
-		_current_block_data->instructions.push_back(_block_data[header_block].instructions[1]);
-		assert(_current_block_data->instructions.back().op == spv::OpBranch);
+		_current_block_data->append(std::move(header_branch));
 
 		// Add condition block if it exists
 		if (condition_block != 0)
-			_current_block_data->append(_block_data[condition_block]);
+			_current_block_data->append(take_block(condition_block));
 
 		// Append loop body block before continue block
-		_current_block_data->append(_block_data[loop_block]);
-		_current_block_data->append(_block_data[continue_block]);
+		_current_block_data->append(take_block(loop_block));
+		_current_block_data->append(take_block(continue_block));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 	}
 	void emit_switch(const location &loc, id, id selector_block, id default_label, id default_block, const std::vector<id> &case_literal_and_labels, const std::vector<id> &case_blocks, unsigned int selection_control) override
 	{
 		assert(case_blocks.size() == case_literal_and_labels.size() / 2);
 
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->pop_back();
+		assert(merge_label.last_op() == spv::OpLabel);
 
 		// Add previous block containing the selector value first
-		_current_block_data->append(_block_data[selector_block]);
+		_current_block_data->append(take_block(selector_block));
 
-		spirv_instruction switch_inst = _current_block_data->instructions.back();
-		assert(switch_inst.op == spv::OpSwitch);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block switch_inst = _current_block_data->pop_back();
+		assert(switch_inst.last_op() == spv::OpSwitch);
 
 		// Add structured control flow instruction
 		add_location(loc, *_current_block_data);
 		add_instruction_without_result(spv::OpSelectionMerge)
-			.add(merge_label.result)
+			.add(_current_block) // Merge label is the one of the current block
 			.add(selection_control & 0x3); // 'SelectionControl' happens to match the flags produced by the parser
 
 		// Update switch instruction to contain all case labels
-		switch_inst.operands[1] = default_label;
-		switch_inst.add(case_literal_and_labels.begin(), case_literal_and_labels.end());
+		switch_inst.words[2] = default_label; // Operand 1 is the default label
+		spirv_instruction { &switch_inst.words, 0, 0, 0 }
+			.add(case_literal_and_labels.begin(), case_literal_and_labels.end());
 
 		// Append all blocks belonging to the switch
-		_current_block_data->instructions.push_back(switch_inst);
+		_current_block_data->append(std::move(switch_inst));
 
 		std::vector<id> blocks = case_blocks;
-		if (default_label != merge_label.result)
+		if (default_label != _current_block)
 			blocks.push_back(default_block);
 		// Eliminate duplicates (because of multiple case labels pointing to the same block)
 		std::sort(blocks.begin(), blocks.end());
 		blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
 		for (const id case_block : blocks)
-			_current_block_data->append(_block_data[case_block]);
+			_current_block_data->append(take_block(case_block));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 	}
 
 	bool is_in_function() const override { return _current_function != nullptr; }
@@ -2150,8 +2279,9 @@ private:
 
 		set_block(id);
 
-		add_instruction_without_result(spv::OpLabel)
-			.result = id;
+		// Most blocks are short, so reserving a little space up front avoids repeated reallocation while they are filled
+		_current_block_data->words.reserve(64);
+		_current_block_data->add_instruction(spv::OpLabel, 0, id);
 	}
 	id   leave_block_and_kill() override
 	{
@@ -2232,7 +2362,7 @@ private:
 	{
 		assert(is_in_function()); // Can only leave if there was a function to begin with
 
-		_current_function->definition = _block_data[_last_block];
+		_current_function->definition = take_block(_last_block);
 
 		// Append function end instruction
 		add_instruction_without_result(spv::OpFunctionEnd, _current_function->definition);
@@ -233,8 +233,13 @@ void reshadefx::expression::add_cast_operation(const reshadefx::type &cast_type)
 					constant.as_float[i] = static_cast<float>(constant.as_int[i]);
 		};
 
-		for (auto &element : constant.array_data)
-			cast_constant(element, type, cast_type);
+		if (!constant.array_data->empty())
+		{
+			std::vector<reshadefx::constant> array_data = *constant.array_data;
+			for (auto &element : array_data)
+				cast_constant(element, type, cast_type);
+			constant.array_data = std::move(array_data);
+		}
 
 		cast_constant(constant, type, cast_type);
 	}
@@ -311,7 +316,7 @@ void reshadefx::expression::add_constant_index_access(unsigned int index)
 	{
 		if (prev_type.is_array())
 		{
-			constant = constant.array_data[index];
+			constant = (*constant.array_data)[index];
 		}
 		else if (prev_type.is_matrix()) // Indexing into a matrix returns a row of it as a vector
 		{
@@ -334,12 +339,12 @@ void reshadefx::expression::add_swizzle_access(const signed char swizzle[4], uns
 
 	const auto prev_type = type;
 
-	type.rows = length;
+	type.rows = static_cast<uint8_t>(length);
 	type.cols = 1;
 
 	if (is_constant)
 	{
-		assert(constant.array_data.empty());
+		assert(constant.array_data->empty());
 
 		uint32_t data[16];
 		std::memcpy(data, &constant.as_uint[0], sizeof(data));
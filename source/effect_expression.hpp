@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <memory> // std::shared_ptr
 
 namespace reshadefx
 {
@@ -94,13 +95,33 @@ namespace reshadefx
 		}
 
 		datatype base = t_void; // Underlying base type ('int', 'float', ...)
-		unsigned int rows = 0; // Number of rows if this is a vector type
-		unsigned int cols = 0; // Number of columns if this is a matrix type
+		uint8_t rows = 0; // Number of rows if this is a vector type (never more than four)
+		uint8_t cols = 0; // Number of columns if this is a matrix type (never more than four)
 		unsigned int qualifiers = 0; // Bit mask of all the qualifiers decorating the type
 		int array_length = 0; // Negative if an unsized array, otherwise the number of elements if this is an array type
 		uint32_t definition = 0; // ID of the matching struct if this is a struct type
 	};
 
+	/// <summary>
+	/// An immutable value that is stored out-of-line and shared between all copies, so that copying it is cheap.
+	/// A default constructed instance does not allocate anything and behaves like an empty value.
+	/// </summary>
+	template <typename T>
+	class shared_value
+	{
+	public:
+		shared_value() = default;
+		shared_value(T value) : _value(std::make_shared<const T>(std::move(value))) {}
+
+		const T &operator*() const { return _value != nullptr ? *_value : empty(); }
+		const T *operator->() const { return &operator*(); }
+
+	private:
+		static const T &empty() { static const T value; return value; }
+
+		std::shared_ptr<const T> _value;
+	};
+
 	/// <summary>
 	/// Structure which encapsulates a parsed constant value
 	/// </summary>
@@ -114,9 +135,9 @@ namespace reshadefx
 		};
 
 		// Optional string associated with this constant
-		std::string string_data = {};
+		shared_value<std::string> string_data = {};
 		// Optional additional elements if this is an array constant
-		std::vector<constant> array_data = {};
+		shared_value<std::vector<constant>> array_data = {};
 	};
 
 	/// <summary>
@@ -5,8 +5,22 @@
 
 #include "effect_lexer.hpp"
 #include <cassert>
+#include <cstring> // std::memchr
+#include <iterator> // std::size
+#include <algorithm> // std::max
 #include <unordered_map> // Used for static lookup tables
 
+// SSE2 is always available on x64 and can be enabled on x86 too, use it to scan over long runs of characters 16 at a time
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+	#define LEXER_USE_SSE2 1
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h> // _BitScanForward
+	#endif
+#else
+	#define LEXER_USE_SSE2 0
+#endif
+
 using namespace reshadefx;
 
 enum token_type
@@ -198,7 +212,14 @@ static const std::unordered_map<tokenid, std::string> token_lookup = {
 	{ tokenid::sampler, "sampler" },
 	{ tokenid::storage, "storage" },
 };
-static const std::unordered_map<std::string, tokenid> keyword_lookup = {
+struct keyword_entry
+{
+	std::string_view name;
+	tokenid id;
+};
+
+// Lookup tables which translate a given identifier to a keyword or preprocessor directive token
+static constexpr keyword_entry keyword_list[] = {
 	{ "asm", tokenid::reserved },
 	{ "asm_fragment", tokenid::reserved },
 	{ "auto", tokenid::reserved },
@@ -432,7 +453,7 @@ static const std::unordered_map<std::string, tokenid> keyword_lookup = {
 	{ "volatile", tokenid::volatile_ },
 	{ "while", tokenid::while_ }
 };
-static const std::unordered_map<std::string, tokenid> pp_directive_lookup = {
+static constexpr keyword_entry pp_directive_list[] = {
 	{ "define", tokenid::hash_def },
 	{ "undef", tokenid::hash_undef },
 	{ "if", tokenid::hash_if },
@@ -447,6 +468,64 @@ static const std::unordered_map<std::string, tokenid> pp_directive_lookup = {
 	{ "include", tokenid::hash_include },
 };
 
+static constexpr uint32_t hash_identifier(std::string_view name)
+{
+	// FNV-1a hash, which is simple enough to be evaluated at compile-time
+	uint32_t hash = 2166136261u;
+	for (const char c : name)
+		hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+	return hash;
+}
+
+/// <summary>
+/// An open addressing hash table of keywords that is built at compile-time, so that it does not need any initialization or memory allocations at runtime.
+/// </summary>
+template <size_t NUM_ENTRIES, size_t NUM_SLOTS>
+struct keyword_table
+{
+	static_assert(NUM_SLOTS > NUM_ENTRIES && (NUM_SLOTS & (NUM_SLOTS - 1)) == 0, "number of slots has to be a power of two larger than the number of entries");
+
+	constexpr keyword_table(const keyword_entry(&list)[NUM_ENTRIES]) : entries(list), slots(), max_probe_count(0)
+	{
+		for (size_t i = 0; i < NUM_ENTRIES; ++i)
+		{
+			unsigned int probe_count = 1;
+			size_t slot = hash_identifier(list[i].name) & (NUM_SLOTS - 1);
+			for (; slots[slot] != 0; slot = (slot + 1) & (NUM_SLOTS - 1))
+				probe_count++;
+
+			slots[slot] = static_cast<uint16_t>(i + 1);
+			max_probe_count = std::max(max_probe_count, probe_count);
+		}
+	}
+
+	/// <summary>
+	/// Look up the token of the keyword matching the specified <paramref name="name"/>.
+	/// </summary>
+	/// <returns><c>true</c> if the name is a keyword and the token was written to <paramref name="id"/>, <c>false</c> otherwise.</returns>
+	bool find(std::string_view name, tokenid &id) const
+	{
+		for (size_t slot = hash_identifier(name) & (NUM_SLOTS - 1); slots[slot] != 0; slot = (slot + 1) & (NUM_SLOTS - 1))
+		{
+			if (const keyword_entry &entry = entries[slots[slot] - 1]; entry.name == name)
+			{
+				id = entry.id;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const keyword_entry *entries;
+	uint16_t slots[NUM_SLOTS]; // One-based index into the list of entries, or zero for an empty slot
+	unsigned int max_probe_count;
+};
+
+static constexpr keyword_table<std::size(keyword_list), 1024> keyword_lookup(keyword_list);
+static constexpr keyword_table<std::size(pp_directive_list), 32> pp_directive_lookup(pp_directive_list);
+static_assert(keyword_lookup.max_probe_count <= 4 && pp_directive_lookup.max_probe_count <= 4, "keyword hash tables have too many collisions");
+
 static inline bool is_octal_digit(char c)
 {
 	return static_cast<unsigned>(c - '0') < 8;
@@ -495,6 +574,79 @@ static long long octal_to_decimal(long long n)
 	return n;
 }
 
+#if LEXER_USE_SSE2
+static inline unsigned int first_set_bit(unsigned int mask)
+{
+	assert(mask != 0);
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+// These return a bit mask with one bit for each of the 16 characters, which is set if the character matches the respective character class
+static inline unsigned int match_space(__m128i chars)
+{
+	// Space characters are ' ', '\t', '\v', '\f' and '\r' (a line feed is not, since it is a token on its own)
+	const __m128i is_blank = _mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('\t')));
+	// Characters in the range '\v' to '\r' subtract to 0 to 2, which saturates to 0 after another unsigned subtraction of 2
+	const __m128i is_vfr = _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(chars, _mm_set1_epi8('\v')), _mm_set1_epi8(2)), _mm_setzero_si128());
+	return _mm_movemask_epi8(_mm_or_si128(is_blank, is_vfr));
+}
+static inline unsigned int match_identifier(__m128i chars)
+{
+	// Setting bit 5 converts upper case letters to lower case ones, which can then be checked with a single range test (c - 'a' <= 25)
+	const __m128i letter_offset = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	const __m128i is_letter = _mm_cmpeq_epi8(_mm_subs_epu8(letter_offset, _mm_set1_epi8(25)), _mm_setzero_si128());
+	const __m128i digit_offset = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+	const __m128i is_digit = _mm_cmpeq_epi8(_mm_subs_epu8(digit_offset, _mm_set1_epi8(9)), _mm_setzero_si128());
+	const __m128i is_underscore = _mm_cmpeq_epi8(chars, _mm_set1_epi8('_'));
+	return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(is_letter, is_digit), is_underscore));
+}
+static inline unsigned int match_comment_stop(__m128i chars)
+{
+	// Multi-line comments need to stop at line feeds (to keep track of the line count) and at potential ends of the comment
+	return _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chars, _mm_set1_epi8('*'))));
+}
+#endif
+
+static const char *find_end_of_space(const char *cur, const char *end)
+{
+#if LEXER_USE_SSE2
+	// Most runs are short, so check the first few characters individually before switching to the vectorized loop
+	for (const char *const scalar_end = cur + 8; cur < scalar_end; cur++)
+		if (cur >= end || type_lookup[uint8_t(*cur)] != SPACE)
+			return cur;
+
+	for (; end - cur >= 16; cur += 16)
+		if (const unsigned int mask = match_space(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cur))) ^ 0xFFFF)
+			return cur + first_set_bit(mask);
+#endif
+	while (cur < end && type_lookup[uint8_t(*cur)] == SPACE)
+		cur++;
+	return cur;
+}
+static const char *find_end_of_identifier(const char *cur, const char *end)
+{
+#if LEXER_USE_SSE2
+	// Most identifiers are short, so check the first few characters individually before switching to the vectorized loop
+	for (const char *const scalar_end = cur + 8; cur < scalar_end; cur++)
+		if (type_lookup[uint8_t(*cur)] != IDENT && type_lookup[uint8_t(*cur)] != DIGIT)
+			return cur;
+
+	for (; end - cur >= 16; cur += 16)
+		if (const unsigned int mask = match_identifier(_mm_loadu_si128(reinterpret_cast<const __m128i *>(cur))) ^ 0xFFFF)
+			return cur + first_set_bit(mask);
+#endif
+	// Do not need to check against the end pointer here, since the input is always terminated by a null character, which is not part of an identifier
+	while (type_lookup[uint8_t(*cur)] == IDENT || type_lookup[uint8_t(*cur)] == DIGIT)
+		cur++;
+	return cur;
+}
+
 std::string reshadefx::token::id_to_name(tokenid id)
 {
 	const auto it = token_lookup.find(id);
@@ -646,20 +798,7 @@ next_token:
 		}
 		else if (_cur[1] == '*')
 		{
-			while (_cur < _end)
-			{
-				if (*_cur == '\n')
-				{
-					_cur_location.line++;
-					_cur_location.column = 1;
-				}
-				else if (_cur[0] == '*' && _cur[1] == '/')
-				{
-					skip(2);
-					break;
-				}
-				skip(1);
-			}
+			skip_multi_line_comment();
 			if (_ignore_comments)
 				goto next_token;
 			tok.id = tokenid::multi_line_comment;
@@ -775,15 +914,47 @@ void reshadefx::lexer::skip(size_t length)
 }
 void reshadefx::lexer::skip_space()
 {
-	// Skip each character until a space is found
-	while (type_lookup[uint8_t(*_cur)] == SPACE && _cur < _end)
-		skip(1);
+	// Skip each character until a character that is not a space is found
+	skip(find_end_of_space(_cur, _end) - _cur);
 }
 void reshadefx::lexer::skip_to_next_line()
 {
-	// Skip each character until a new line feed is found
-	while (*_cur != '\n' && _cur < _end)
+	// Skip each character until a new line feed is found ('memchr' is vectorized already)
+	if (_cur >= _end)
+		return;
+	const auto next_line = static_cast<const char *>(std::memchr(_cur, '\n', _end - _cur));
+	skip((next_line != nullptr ? next_line : _end) - _cur);
+}
+void reshadefx::lexer::skip_multi_line_comment()
+{
+	// Skip the initial '/' (but not the '*', so that '/*/' closes the comment)
+	skip(1);
+
+	while (_cur < _end)
+	{
+#if LEXER_USE_SSE2
+		// Skip ahead to the next character that can affect the comment scanning state
+		for (unsigned int mask; _end - _cur >= 16; skip(16))
+			if ((mask = match_comment_stop(_mm_loadu_si128(reinterpret_cast<const __m128i *>(_cur)))) != 0)
+			{
+				skip(first_set_bit(mask));
+				break;
+			}
+		if (_cur >= _end)
+			break;
+#endif
+		if (*_cur == '\n')
+		{
+			_cur_location.line++;
+			_cur_location.column = 1;
+		}
+		else if (_cur[0] == '*' && _cur[1] == '/')
+		{
+			skip(2);
+			break;
+		}
 		skip(1);
+	}
 }
 
 void reshadefx::lexer::reset_to_offset(size_t offset)
@@ -794,10 +965,10 @@ void reshadefx::lexer::reset_to_offset(size_t offset)
 
 void reshadefx::lexer::parse_identifier(token &tok) const
 {
-	auto *const begin = _cur, *end = begin;
+	auto *const begin = _cur;
 
-	// Skip to the end of the identifier sequence
-	do end++; while (type_lookup[uint8_t(*end)] == IDENT || type_lookup[uint8_t(*end)] == DIGIT);
+	// Skip to the end of the identifier sequence (the first character was already checked by the caller)
+	auto *const end = find_end_of_identifier(begin + 1, _end);
 
 	tok.id = tokenid::identifier;
 	tok.offset = input_offset();
@@ -807,9 +978,7 @@ void reshadefx::lexer::parse_identifier(token &tok) const
 	if (_ignore_keywords)
 		return;
 
-	if (const auto it = keyword_lookup.find(tok.literal_as_string);
-		it != keyword_lookup.end())
-		tok.id = it->second;
+	keyword_lookup.find(std::string_view(begin, end - begin), tok.id);
 }
 bool reshadefx::lexer::parse_pp_directive(token &tok)
 {
@@ -817,12 +986,8 @@ bool reshadefx::lexer::parse_pp_directive(token &tok)
 	skip_space(); // Skip any space between the '#' and directive
 	parse_identifier(tok);
 
-	if (const auto it = pp_directive_lookup.find(tok.literal_as_string);
-		it != pp_directive_lookup.end())
-	{
-		tok.id = it->second;
+	if (pp_directive_lookup.find(tok.literal_as_string, tok.id))
 		return true;
-	}
 	else if (!_ignore_line_directives && tok.literal_as_string == "line") // The #line directive needs special handling
 	{
 		skip(tok.length); // The 'parse_identifier' does not update the pointer to the current character, so do that now
@@ -844,7 +1009,8 @@ bool reshadefx::lexer::parse_pp_directive(token &tok)
 			token temptok;
 			parse_string_literal(temptok, false);
 
-			_cur_location.source = std::move(temptok.literal_as_string);
+			if (_sources != nullptr)
+				_cur_location.source_id = _sources->intern(temptok.literal_as_string);
 		}
 
 		// Do not return the #line directive as token to the caller
@@ -1119,3 +1285,105 @@ void reshadefx::lexer::parse_numeric_literal(token &tok) const
 
 	tok.length = end - begin;
 }
+
+static inline bool is_numeric_literal(tokenid id)
+{
+	return id == tokenid::int_literal || id == tokenid::uint_literal || id == tokenid::float_literal || id == tokenid::double_literal;
+}
+
+void reshadefx::token_buffer::append(lexer &lexer)
+{
+	// Estimate about one token per four characters of input to avoid most reallocations
+	const size_t estimated_size = _ids.size() + (lexer.input_string().size() - lexer.input_offset()) / 4 + 1;
+	_ids.reserve(estimated_size);
+	_offsets.reserve(estimated_size);
+	_lengths.reserve(estimated_size);
+	_lines.reserve(estimated_size);
+	_columns.reserve(estimated_size);
+	_sources.reserve(estimated_size);
+	_literals.reserve(estimated_size);
+
+	token tok;
+	do
+	{
+		tok = lexer.lex();
+
+		_ids.push_back(tok.id);
+		_offsets.push_back(static_cast<uint32_t>(tok.offset));
+		_lengths.push_back(static_cast<uint32_t>(tok.length));
+		_lines.push_back(tok.location.line);
+		_columns.push_back(tok.location.column);
+		_sources.push_back(tok.location.source_id);
+
+		if (is_numeric_literal(tok.id))
+		{
+			uint64_t value;
+			std::memcpy(&value, &tok.literal_as_double, sizeof(value));
+			_literals.push_back(static_cast<uint32_t>(_numeric_values.size()));
+			_numeric_values.push_back(value);
+		}
+		else
+		{
+			_literals.push_back(intern_literal(tok.literal_as_string));
+		}
+	} while (tok.id != tokenid::end_of_file);
+}
+
+void reshadefx::token_buffer::read(size_t index, token &tok) const
+{
+	tok.id = _ids[index];
+	tok.offset = _offsets[index];
+	tok.length = _lengths[index];
+	tok.location.line = _lines[index];
+	tok.location.column = _columns[index];
+	tok.location.source_id = _sources[index];
+
+	if (is_numeric_literal(tok.id))
+		std::memcpy(&tok.literal_as_double, &_numeric_values[_literals[index]], sizeof(tok.literal_as_double));
+	else
+		tok.literal_as_double = 0;
+
+	tok.literal_as_string.clear();
+}
+std::string_view reshadefx::token_buffer::literal(size_t index) const
+{
+	if (is_numeric_literal(_ids[index]))
+		return std::string_view();
+
+	return _literal_strings[_literals[index]];
+}
+void reshadefx::token_buffer::apply_source_map(const source_map &map)
+{
+	// Tokens are sorted by line, so can walk the map entries alongside them
+	size_t entry_index = 0;
+	for (size_t index = 0; index < _lines.size(); ++index)
+	{
+		const unsigned int output_line = _lines[index] - 1;
+		while (entry_index < map.entries.size() && map.entries[entry_index].output_line <= output_line)
+			++entry_index;
+		if (entry_index == 0)
+			continue; // No entry applies to lines before the first one
+
+		const source_map::entry &entry = map.entries[entry_index - 1];
+		_lines[index] = entry.line + (output_line - entry.output_line);
+		_sources[index] = entry.source_id;
+	}
+}
+
+uint32_t reshadefx::token_buffer::intern_literal(const std::string &literal)
+{
+	if (_literal_strings.empty())
+		_literal_strings.emplace_back(); // Reserve the first entry for the empty string
+	if (literal.empty())
+		return 0;
+
+	// Look up first, since 'emplace' would allocate a new node even if the literal already exists
+	if (const auto it = _literal_lookup.find(literal);
+		it != _literal_lookup.end())
+		return it->second;
+
+	const auto index = static_cast<uint32_t>(_literal_strings.size());
+	_literal_lookup.emplace(literal, index);
+	_literal_strings.push_back(literal);
+	return index;
+}
@@ -6,6 +6,9 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <memory> // std::shared_ptr
+#include <string_view>
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -15,6 +18,9 @@ namespace reshadefx
 	class lexer
 	{
 	public:
+		/// <summary>
+		/// Construct a lexical analyzer that takes ownership of the specified input string.
+		/// </summary>
 		explicit lexer(
 			std::string input,
 			bool ignore_comments = true,
@@ -24,7 +30,30 @@ namespace reshadefx
 			bool ignore_keywords = false,
 			bool escape_string_literals = true,
 			const location &start_location = location()) :
-			_input(std::move(input)),
+			lexer(std::string_view(), nullptr, ignore_comments, ignore_whitespace, ignore_pp_directives, ignore_line_directives, ignore_keywords, escape_string_literals, start_location)
+		{
+			auto owner = std::make_shared<const std::string>(std::move(input));
+			_input = *owner;
+			_input_owner = std::move(owner);
+			_cur = _input.data();
+			_end = _cur + _input.size();
+		}
+		/// <summary>
+		/// Construct a lexical analyzer that borrows the specified input string without copying it.
+		/// The memory has to stay valid for as long as <paramref name="input_owner"/> is alive and must be followed by a null character.
+		/// </summary>
+		lexer(
+			std::string_view input,
+			std::shared_ptr<const void> input_owner,
+			bool ignore_comments = true,
+			bool ignore_whitespace = true,
+			bool ignore_pp_directives = true,
+			bool ignore_line_directives = false,
+			bool ignore_keywords = false,
+			bool escape_string_literals = true,
+			const location &start_location = location()) :
+			_input(input),
+			_input_owner(std::move(input_owner)),
 			_cur_location(start_location),
 			_ignore_comments(ignore_comments),
 			_ignore_whitespace(ignore_whitespace),
@@ -37,22 +66,9 @@ namespace reshadefx
 			_end = _cur + _input.size();
 		}
 
-		lexer(const lexer &lexer) { operator=(lexer); }
-		lexer &operator=(const lexer &lexer)
-		{
-			_input = lexer._input;
-			_cur_location = lexer._cur_location;
-			reset_to_offset(lexer._cur - lexer._input.data());
-			_end = _input.data() + _input.size();
-			_ignore_comments = lexer._ignore_comments;
-			_ignore_whitespace = lexer._ignore_whitespace;
-			_ignore_pp_directives = lexer._ignore_pp_directives;
-			_ignore_keywords = lexer._ignore_keywords;
-			_escape_string_literals = lexer._escape_string_literals;
-			_ignore_line_directives = lexer._ignore_line_directives;
-
-			return *this;
-		}
+		// Copying a lexer only copies the reference to the input, which is shared between all copies
+		lexer(const lexer &lexer) = default;
+		lexer &operator=(const lexer &lexer) = default;
 
 		/// <summary>
 		/// Get the current position in the input string.
@@ -62,8 +78,13 @@ namespace reshadefx
 		/// <summary>
 		/// Get the input string this lexical analyzer works on.
 		/// </summary>
-		/// <returns>A constant reference to the input string.</returns>
-		const std::string &input_string() const { return _input; }
+		/// <returns>A view of the input string.</returns>
+		std::string_view input_string() const { return _input; }
+
+		/// <summary>
+		/// Set the table that source file names from #line directives are added to. If there is none, those names are ignored.
+		/// </summary>
+		void set_source_table(source_table *sources) { _sources = sources; }
 
 		/// <summary>
 		/// Perform lexical analysis on the input string and return the next token in sequence.
@@ -92,15 +113,21 @@ namespace reshadefx
 		/// </summary>
 		/// <param name="length">The number of input characters to skip.</param>
 		void skip(size_t length);
+		/// <summary>
+		/// Skips a multi-line comment, starting at its opening '/*' characters.
+		/// </summary>
+		void skip_multi_line_comment();
 
 		void parse_identifier(token &tok) const;
 		bool parse_pp_directive(token &tok);
 		void parse_string_literal(token &tok, bool escape);
 		void parse_numeric_literal(token &tok) const;
 
-		std::string _input;
+		std::string_view _input;
+		std::shared_ptr<const void> _input_owner;
 		location _cur_location;
-		const std::string::value_type *_cur, *_end;
+		source_table *_sources = nullptr;
+		const std::string_view::value_type *_cur, *_end;
 		bool _ignore_comments;
 		bool _ignore_whitespace;
 		bool _ignore_pp_directives;
@@ -108,4 +135,55 @@ namespace reshadefx
 		bool _ignore_keywords;
 		bool _escape_string_literals;
 	};
+
+	/// <summary>
+	/// A compact list of tokens, stored as a structure of arrays with all literal strings interned into a shared table.
+	/// This allows random access to any token, e.g. to cheaply go back to a previous one.
+	/// </summary>
+	class token_buffer
+	{
+	public:
+		/// <summary>
+		/// Perform lexical analysis on the remaining input of the specified <paramref name="lexer"/> and append all tokens, up to and including the end of file token.
+		/// </summary>
+		void append(lexer &lexer);
+
+		/// <summary>
+		/// Get the number of tokens in this buffer.
+		/// </summary>
+		size_t size() const { return _ids.size(); }
+
+		/// <summary>
+		/// Get the identifier of the token at the specified <paramref name="index"/>.
+		/// </summary>
+		tokenid id(size_t index) const { return _ids[index]; }
+
+		/// <summary>
+		/// Copy the token at the specified <paramref name="index"/> into <paramref name="tok"/>, except for its literal string.
+		/// Use <see cref="literal"/> to access that without making a copy.
+		/// </summary>
+		void read(size_t index, token &tok) const;
+
+		/// <summary>
+		/// Get the literal string of the token at the specified <paramref name="index"/> (empty for numeric literals).
+		/// The view stays valid until more tokens are appended to this buffer.
+		/// </summary>
+		std::string_view literal(size_t index) const;
+
+		/// <summary>
+		/// Translate the locations of all tokens from lines of pre-processed output to the source file locations in the specified <paramref name="map"/>.
+		/// </summary>
+		void apply_source_map(const source_map &map);
+
+	private:
+		uint32_t intern_literal(const std::string &literal);
+
+		std::vector<tokenid> _ids;
+		std::vector<uint32_t> _offsets, _lengths;
+		std::vector<uint32_t> _lines, _columns, _sources;
+		std::vector<uint32_t> _literals; // Index into the numeric value table for numeric literals and into the string table for all other tokens
+		std::vector<uint64_t> _numeric_values;
+		std::vector<std::string> _literal_strings;
+		std::unordered_map<std::string, uint32_t> _literal_lookup;
+	};
 }
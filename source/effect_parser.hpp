@@ -16,17 +16,19 @@ namespace reshadefx
 	class parser : symbol_table
 	{
 	public:
-		// Define constructor explicitly because lexer class is not included here
+		// Define constructor explicitly because token buffer class is not included here
 		parser();
 		~parser();
 
 		/// <summary>
-		/// Parse the provided input string.
+		/// Parse the provided pre-processed input string, using the specified source map to get the code locations instead of #line directives.
+		/// There is intentionally no overload without a source map, since the output of the preprocessor no longer contains #line directives and would lose all code locations.
 		/// </summary>
 		/// <param name="source">The string to analyze.</param>
+		/// <param name="source_map">The map from lines in the input string to source file locations, as generated by the preprocessor. Pass an empty map for input that embeds #line directives instead (see <see cref="preprocessor::output_with_line_directives"/>).</param>
 		/// <param name="backend">The code generation implementation to use.</param>
 		/// <returns>A boolean value indicating whether parsing was successful or not.</returns>
-		bool parse(std::string source, class codegen *backend);
+		bool parse(std::string source, const source_map &source_map, class codegen *backend);
 
 		/// <summary>
 		/// Get the list of error messages.
@@ -77,9 +79,12 @@ namespace reshadefx
 
 		codegen *_codegen = nullptr;
 		std::string _errors;
-		token _token, _token_next, _token_backup;
-		std::unique_ptr<class lexer> _lexer;
-		size_t _lexer_backup_offset = 0;
+		source_table _sources;
+		token _token, _token_next;
+		std::string_view _token_literal, _token_next_literal; // Literal strings of the above tokens, pointing into the token buffer
+		std::unique_ptr<class token_buffer> _tokens;
+		size_t _token_index = 0;
+		size_t _token_backup_index = 0;
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
 		reshadefx::function_info *_current_function = nullptr;
@@ -17,7 +17,7 @@ reshadefx::parser::~parser()
 
 void reshadefx::parser::error(const location &location, unsigned int code, const std::string &message)
 {
-	_errors += location.source;
+	_errors += _sources[location];
 	_errors += '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": error";
 	_errors += (code == 0) ? ": " : " X" + std::to_string(code) + ": ";
 	_errors += message;
@@ -25,7 +25,7 @@ void reshadefx::parser::error(const location &location, unsigned int code, const
 }
 void reshadefx::parser::warning(const location &location, unsigned int code, const std::string &message)
 {
-	_errors += location.source;
+	_errors += _sources[location];
 	_errors += '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": warning";
 	_errors += (code == 0) ? ": " : " X" + std::to_string(code) + ": ";
 	_errors += message;
@@ -34,19 +34,26 @@ void reshadefx::parser::warning(const location &location, unsigned int code, con
 
 void reshadefx::parser::backup()
 {
-	_token_backup = _token_next;
-	_lexer_backup_offset = _lexer->input_offset();
+	// The next token is the one that was read last from the token buffer
+	_token_backup_index = _token_index - 1;
 }
 void reshadefx::parser::restore()
 {
-	_lexer->reset_to_offset(_lexer_backup_offset);
-	_token_next = _token_backup; // Copy instead of move here, since restore may be called twice (from 'accept_type_class' and then again from 'parse_expression_unary')
+	// This may be called twice for the same backup (from 'accept_type_class' and then again from 'parse_expression_unary'), which is fine since it only resets the index
+	_token_index = _token_backup_index;
+	_token_next_literal = _tokens->literal(_token_index);
+	_tokens->read(_token_index++, _token_next);
 }
 
 void reshadefx::parser::consume()
 {
-	_token = std::move(_token_next);
-	_token_next = _lexer->lex();
+	_token = _token_next;
+	_token_literal = _token_next_literal;
+
+	// Keep returning the end of file token once all tokens were consumed
+	const size_t index = _token_index < _tokens->size() ? _token_index++ : _tokens->size() - 1;
+	_tokens->read(index, _token_next);
+	_token_next_literal = _tokens->literal(index);
 }
 void reshadefx::parser::consume_until(tokenid tokid)
 {
@@ -90,14 +97,15 @@ bool reshadefx::parser::accept_symbol(std::string &identifier, scoped_symbol &sy
 		return false;
 	}
 
-	identifier = std::move(_token.literal_as_string);
+	identifier = std::string(_token_literal);
 
 	// Can concatenate multiple '::' to force symbol search for a specific namespace level
 	while (accept(tokenid::colon_colon))
 	{
 		if (!expect(tokenid::identifier))
 			return false;
-		identifier += "::" + std::move(_token.literal_as_string);
+		identifier += "::";
+		identifier += _token_literal;
 	}
 
 	// Figure out which scope to start searching in
@@ -151,7 +159,7 @@ bool reshadefx::parser::accept_type_class(type &type)
 			else if (_token.literal_as_int < 1 || _token.literal_as_int > 4)
 				return error(_token.location, 3052, "vector dimension must be between 1 and 4"), false;
 
-			type.rows = static_cast<unsigned int>(_token.literal_as_int);
+			type.rows = static_cast<uint8_t>(_token.literal_as_int);
 
 			if (!expect('>'))
 				return false;
@@ -176,14 +184,14 @@ bool reshadefx::parser::accept_type_class(type &type)
 			else if (_token.literal_as_int < 1 || _token.literal_as_int > 4)
 				return error(_token.location, 3053, "matrix dimensions must be between 1 and 4"), false;
 
-			type.rows = static_cast<unsigned int>(_token.literal_as_int);
+			type.rows = static_cast<uint8_t>(_token.literal_as_int);
 
 			if (!expect(',') || !expect(tokenid::int_literal))
 				return false;
 			else if (_token.literal_as_int < 1 || _token.literal_as_int > 4)
 				return error(_token.location, 3053, "matrix dimensions must be between 1 and 4"), false;
 
-			type.cols = static_cast<unsigned int>(_token.literal_as_int);
+			type.cols = static_cast<uint8_t>(_token.literal_as_int);
 
 			if (!expect('>'))
 				return false;
@@ -202,7 +210,7 @@ bool reshadefx::parser::accept_type_class(type &type)
 	case tokenid::bool3:
 	case tokenid::bool4:
 		type.base = type::t_bool;
-		type.rows = 1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::bool_));
+		type.rows = static_cast<uint8_t>(1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::bool_)));
 		type.cols = 1;
 		break;
 	case tokenid::bool2x2:
@@ -215,15 +223,15 @@ bool reshadefx::parser::accept_type_class(type &type)
 	case tokenid::bool4x3:
 	case tokenid::bool4x4:
 		type.base = type::t_bool;
-		type.rows = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::bool2x2)) / 3;
-		type.cols = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::bool2x2)) % 3;
+		type.rows = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::bool2x2)) / 3);
+		type.cols = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::bool2x2)) % 3);
 		break;
 	case tokenid::int_:
 	case tokenid::int2:
 	case tokenid::int3:
 	case tokenid::int4:
 		type.base = type::t_int;
-		type.rows = 1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::int_));
+		type.rows = static_cast<uint8_t>(1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::int_)));
 		type.cols = 1;
 		break;
 	case tokenid::int2x2:
@@ -236,15 +244,15 @@ bool reshadefx::parser::accept_type_class(type &type)
 	case tokenid::int4x3:
 	case tokenid::int4x4:
 		type.base = type::t_int;
-		type.rows = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::int2x2)) / 3;
-		type.cols = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::int2x2)) % 3;
+		type.rows = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::int2x2)) / 3);
+		type.cols = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::int2x2)) % 3);
 		break;
 	case tokenid::min16int:
 	case tokenid::min16int2:
 	case tokenid::min16int3:
 	case tokenid::min16int4:
 		type.base = type::t_min16int;
-		type.rows = 1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::min16int));
+		type.rows = static_cast<uint8_t>(1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::min16int)));
 		type.cols = 1;
 		break;
 	case tokenid::uint_:
@@ -252,7 +260,7 @@ bool reshadefx::parser::accept_type_class(type &type)
 	case tokenid::uint3:
 	case tokenid::uint4:
 		type.base = type::t_uint;
-		type.rows = 1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::uint_));
+		type.rows = static_cast<uint8_t>(1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::uint_)));
 		type.cols = 1;
 		break;
 	case tokenid::uint2x2:
@@ -265,15 +273,15 @@ bool reshadefx::parser::accept_type_class(type &type)
 	case tokenid::uint4x3:
 	case tokenid::uint4x4:
 		type.base = type::t_uint;
-		type.rows = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::uint2x2)) / 3;
-		type.cols = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::uint2x2)) % 3;
+		type.rows = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::uint2x2)) / 3);
+		type.cols = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::uint2x2)) % 3);
 		break;
 	case tokenid::min16uint:
 	case tokenid::min16uint2:
 	case tokenid::min16uint3:
 	case tokenid::min16uint4:
 		type.base = type::t_min16uint;
-		type.rows = 1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::min16uint));
+		type.rows = static_cast<uint8_t>(1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::min16uint)));
 		type.cols = 1;
 		break;
 	case tokenid::float_:
@@ -281,7 +289,7 @@ bool reshadefx::parser::accept_type_class(type &type)
 	case tokenid::float3:
 	case tokenid::float4:
 		type.base = type::t_float;
-		type.rows = 1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::float_));
+		type.rows = static_cast<uint8_t>(1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::float_)));
 		type.cols = 1;
 		break;
 	case tokenid::float2x2:
@@ -294,15 +302,15 @@ bool reshadefx::parser::accept_type_class(type &type)
 	case tokenid::float4x3:
 	case tokenid::float4x4:
 		type.base = type::t_float;
-		type.rows = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::float2x2)) / 3;
-		type.cols = 2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::float2x2)) % 3;
+		type.rows = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::float2x2)) / 3);
+		type.cols = static_cast<uint8_t>(2 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::float2x2)) % 3);
 		break;
 	case tokenid::min16float:
 	case tokenid::min16float2:
 	case tokenid::min16float3:
 	case tokenid::min16float4:
 		type.base = type::t_min16float;
-		type.rows = 1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::min16float));
+		type.rows = static_cast<uint8_t>(1 + (static_cast<unsigned int>(_token_next.id) - static_cast<unsigned int>(tokenid::min16float)));
 		type.cols = 1;
 		break;
 	case tokenid::string_:
@@ -582,7 +590,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 	else if (accept('{'))
 	{
 		bool is_constant = true;
-		std::vector<expression> elements;
+		std::pmr::vector<expression> elements(_codegen->arena());
 		type composite_type = { type::t_void, 1, 1 };
 
 		while (!peek('}'))
@@ -613,13 +621,17 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 		// Constant arrays can be constructed at compile time
 		if (is_constant)
 		{
-			constant res = {};
+			std::vector<constant> array_data;
+			array_data.reserve(elements.size());
 			for (expression &element : elements)
 			{
 				element.add_cast_operation(composite_type);
-				res.array_data.push_back(element.constant);
+				array_data.push_back(element.constant);
 			}
 
+			constant res = {};
+			res.array_data = std::move(array_data);
+
 			composite_type.array_length = static_cast<int>(elements.size());
 
 			exp.reset_to_rvalue_constant(location, std::move(res), composite_type);
@@ -670,11 +682,11 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 	}
 	else if (accept(tokenid::string_literal))
 	{
-		std::string value = std::move(_token.literal_as_string);
+		std::string value = std::string(_token_literal);
 
 		// Multiple string literals in sequence are concatenated into a single string literal
 		while (accept(tokenid::string_literal))
-			value += _token.literal_as_string;
+			value += _token_literal;
 
 		exp.reset_to_rvalue_constant(location, std::move(value));
 	}
@@ -692,7 +704,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 		// Parse entire argument expression list
 		bool is_constant = true;
 		unsigned int num_components = 0;
-		std::vector<expression> arguments;
+		std::pmr::vector<expression> arguments(_codegen->arena());
 
 		while (!peek(')'))
 		{
@@ -797,7 +809,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 				return error(location, 3005, "identifier '" + identifier + "' represents a variable, not a function"), false;
 
 			// Parse entire argument expression list
-			std::vector<expression> arguments;
+			std::pmr::vector<expression> arguments(_codegen->arena());
 
 			while (!peek(')'))
 			{
@@ -834,7 +846,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 
 			assert(symbol.function != nullptr);
 
-			std::vector<expression> parameters(arguments.size());
+			std::pmr::vector<expression> parameters(arguments.size(), _codegen->arena());
 
 			// We need to allocate some temporary variables to pass in and load results from pointer parameters
 			for (size_t i = 0; i < arguments.size(); ++i)
@@ -989,7 +1001,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 				return false;
 
 			location = std::move(_token.location);
-			const auto subscript = std::move(_token.literal_as_string);
+			const auto subscript = std::string(_token_literal);
 
 			if (accept('(')) // Methods (function calls on types) are not supported right now
 			{
@@ -1127,7 +1139,7 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 
 				// Promote scalar to vector type using cast
 				auto target_type = exp.type;
-				target_type.rows = static_cast<unsigned int>(length);
+				target_type.rows = static_cast<uint8_t>(length);
 
 				exp.add_cast_operation(target_type);
 
@@ -17,12 +17,23 @@ struct on_scope_exit
 	std::function<void()> leave;
 };
 
-bool reshadefx::parser::parse(std::string input, codegen *backend)
+bool reshadefx::parser::parse(std::string input, const source_map &source_map, codegen *backend)
 {
-	_lexer.reset(new lexer(std::move(input)));
+	// Source file names are referenced by index, so start out with the ones from the map
+	_sources = source_map.sources;
+
+	// Tokenize the entire input up front, so that going back to a previous token does not require lexing it again
+	lexer lexer(std::move(input));
+	lexer.set_source_table(&_sources);
+	_tokens.reset(new token_buffer());
+	_tokens->append(lexer);
+	if (!source_map.entries.empty())
+		_tokens->apply_source_map(source_map);
+	_token_index = 0;
 
 	// Set backend for subsequent code-generation
 	_codegen = backend;
+	_codegen->set_source_table(&_sources);
 
 	consume();
 
@@ -46,7 +57,7 @@ void reshadefx::parser::parse_top(bool &parse_success)
 			return;
 		}
 
-		const auto name = std::move(_token.literal_as_string);
+		const auto name = std::string(_token_literal);
 
 		if (!expect('{'))
 		{
@@ -87,7 +98,7 @@ void reshadefx::parser::parse_top(bool &parse_success)
 
 			if (peek('('))
 			{
-				const auto name = std::move(_token.literal_as_string);
+				const auto name = std::string(_token_literal);
 				// This is definitely a function declaration, so parse it
 				if (!parse_function(type, name))
 				{
@@ -107,7 +118,7 @@ void reshadefx::parser::parse_top(bool &parse_success)
 						parse_success = false;
 						return;
 					}
-					const auto name = std::move(_token.literal_as_string);
+					const auto name = std::string(_token_literal);
 					if (!parse_variable(type, name, true))
 					{
 						// Insert dummy variable into symbol table, so later references can be resolved despite the error
@@ -161,7 +172,7 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			switch_call = (0x8 << 4)
 		};
 
-		const auto attribute = std::move(_token_next.literal_as_string);
+		const auto attribute = std::string(_token_next_literal);
 
 		if (!expect(tokenid::identifier) || !expect(']'))
 			return false;
@@ -385,7 +396,7 @@ bool reshadefx::parser::parse_statement(bool scoped)
 				do { // There may be multiple declarations behind a type, so loop through them
 					if (count++ > 0 && !expect(','))
 						return false;
-					if (!expect(tokenid::identifier) || !parse_variable(type, std::move(_token.literal_as_string)))
+					if (!expect(tokenid::identifier) || !parse_variable(type, std::string(_token_literal)))
 						return false;
 				} while (!peek(';'));
 			}
@@ -707,7 +718,7 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			if (count++ > 0 && !expect(','))
 				// Try to consume the rest of the declaration so that parsing may continue despite the error
 				return consume_until(';'), false;
-			if (!expect(tokenid::identifier) || !parse_variable(type, std::move(_token.literal_as_string)))
+			if (!expect(tokenid::identifier) || !parse_variable(type, std::string(_token_literal)))
 				return consume_until(';'), false;
 		} while (!peek(';'));
 
@@ -837,7 +848,7 @@ bool reshadefx::parser::parse_annotations(std::vector<annotation> &annotations)
 		if (!expect(tokenid::identifier))
 			return consume_until('>'), false;
 
-		auto name = std::move(_token.literal_as_string);
+		auto name = std::string(_token_literal);
 
 		if (expression expression; !expect('=') || !parse_expression_multary(expression) || !expect(';'))
 			return consume_until('>'), false;
@@ -858,7 +869,7 @@ bool reshadefx::parser::parse_struct()
 	struct_info info;
 	// The structure name is optional
 	if (accept(tokenid::identifier))
-		info.name = std::move(_token.literal_as_string);
+		info.name = std::string(_token_literal);
 	else
 		info.name = "_anonymous_struct_" + std::to_string(location.line) + '_' + std::to_string(location.column);
 
@@ -885,7 +896,7 @@ bool reshadefx::parser::parse_struct()
 			if (!expect(tokenid::identifier))
 				return consume_until('}'), accept(';'), false;
 
-			member.name = std::move(_token.literal_as_string);
+			member.name = std::string(_token_literal);
 			member.location = std::move(_token.location);
 
 			if (member.type.is_void())
@@ -927,7 +938,7 @@ bool reshadefx::parser::parse_struct()
 				if (!expect(tokenid::identifier))
 					return consume_until('}'), accept(';'), false;
 
-				member.semantic = std::move(_token.literal_as_string);
+				member.semantic = std::string(_token_literal);
 				// Make semantic upper case to simplify comparison later on
 				std::transform(member.semantic.begin(), member.semantic.end(), member.semantic.begin(), [](char c) { return static_cast<char>(toupper(c)); });
 
@@ -1026,7 +1037,7 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 			break;
 		}
 
-		param.name = std::move(_token.literal_as_string);
+		param.name = std::string(_token_literal);
 		param.location = std::move(_token.location);
 
 		if (param.type.is_void())
@@ -1076,7 +1087,7 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 				break;
 			}
 
-			param.semantic = std::move(_token.literal_as_string);
+			param.semantic = std::string(_token_literal);
 			// Make semantic upper case to simplify comparison later on
 			std::transform(param.semantic.begin(), param.semantic.end(), param.semantic.begin(), [](char c) { return static_cast<char>(toupper(c)); });
 
@@ -1108,7 +1119,7 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 		if (type.is_void())
 			return error(_token.location, 3076, '\'' + name + "': void function cannot have a semantic"), false;
 
-		info.return_semantic = std::move(_token.literal_as_string);
+		info.return_semantic = std::string(_token_literal);
 		// Make semantic upper case to simplify comparison later on
 		std::transform(info.return_semantic.begin(), info.return_semantic.end(), info.return_semantic.begin(), [](char c) { return static_cast<char>(toupper(c)); });
 	}
@@ -1215,7 +1226,7 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 			return error(_token.location, 3043, '\'' + name + "': local variables cannot have semantics"), false;
 
 		std::string &semantic = texture_info.semantic;
-		semantic = std::move(_token.literal_as_string);
+		semantic = std::string(_token_literal);
 
 		// Make semantic upper case to simplify comparison later on
 		std::transform(semantic.begin(), semantic.end(), semantic.begin(), [](char c) { return static_cast<char>(toupper(c)); });
@@ -1272,7 +1283,7 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 				if (!expect(tokenid::identifier))
 					return consume_until('}'), false;
 
-				const auto property_name = std::move(_token.literal_as_string);
+				const auto property_name = std::string(_token_literal);
 				const auto property_location = std::move(_token.location);
 
 				if (!expect('='))
@@ -1285,7 +1296,8 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 				if (accept(tokenid::identifier)) // Handle special enumeration names for property values
 				{
 					// Transform identifier to uppercase to do case-insensitive comparison
-					std::transform(_token.literal_as_string.begin(), _token.literal_as_string.end(), _token.literal_as_string.begin(), [](char c) { return static_cast<char>(toupper(c)); });
+					std::string value_name(_token_literal);
+					std::transform(value_name.begin(), value_name.end(), value_name.begin(), [](char c) { return static_cast<char>(toupper(c)); });
 
 					static const std::unordered_map<std::string, uint32_t> s_values = {
 						{ "NONE", 0 }, { "POINT", 0 },
@@ -1309,7 +1321,7 @@ bool reshadefx::parser::parse_variable(type type, std::string name, bool global)
 					};
 
 					// Look up identifier in list of possible enumeration names
-					if (const auto it = s_values.find(_token.literal_as_string);
+					if (const auto it = s_values.find(value_name);
 						it != s_values.end())
 						expression.reset_to_rvalue_constant(_token.location, it->second);
 					else // No match found, so rewind to parser state before the identifier was consumed and try parsing it as a normal expression
@@ -1490,7 +1502,7 @@ bool reshadefx::parser::parse_technique()
 		return false;
 
 	technique_info info;
-	info.name = std::move(_token.literal_as_string);
+	info.name = std::string(_token_literal);
 
 	bool parse_success = parse_annotations(info.annotations);
 
@@ -1521,7 +1533,7 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 
 	// Passes can have an optional name
 	if (accept(tokenid::identifier))
-		info.name = std::move(_token.literal_as_string);
+		info.name = std::string(_token_literal);
 
 	bool parse_success = true;
 	bool targets_support_srgb = true;
@@ -1537,7 +1549,7 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 			return consume_until('}'), false;
 
 		auto location = std::move(_token.location);
-		const auto state = std::move(_token.literal_as_string);
+		const auto state = std::string(_token_literal);
 
 		if (!expect('='))
 			return consume_until('}'), false;
@@ -1666,7 +1678,8 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 			if (accept(tokenid::identifier)) // Handle special enumeration names for pass states
 			{
 				// Transform identifier to uppercase to do case-insensitive comparison
-				std::transform(_token.literal_as_string.begin(), _token.literal_as_string.end(), _token.literal_as_string.begin(), [](char c) { return static_cast<char>(toupper(c)); });
+				std::string value_name(_token_literal);
+				std::transform(value_name.begin(), value_name.end(), value_name.begin(), [](char c) { return static_cast<char>(toupper(c)); });
 
 				static const std::unordered_map<std::string, uint32_t> s_enum_values = {
 					{ "NONE", 0 }, { "ZERO", 0 }, { "ONE", 1 },
@@ -1709,7 +1722,7 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 				};
 
 				// Look up identifier in list of possible enumeration names
-				if (const auto it = s_enum_values.find(_token.literal_as_string);
+				if (const auto it = s_enum_values.find(value_name);
 					it != s_enum_values.end())
 					expression.reset_to_rvalue_constant(_token.location, it->second);
 				else // No match found, so rewind to parser state before the identifier was consumed and try parsing it as a normal expression
@@ -5,8 +5,19 @@
 
 #include "effect_lexer.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_text.hpp"
 #include <cassert>
-#include <algorithm> // std::find_if
+#include <algorithm> // std::count, std::find_if
+#include <limits> // std::numeric_limits
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
 
 #ifndef _WIN32
 	// On Linux systems the native path encoding is UTF-8 already, so no conversion necessary
@@ -63,8 +74,135 @@ static const int precedence_lookup[] = {
 	11, 11, 11, 11 // unary operators
 };
 
-static bool read_file(const std::filesystem::path &path, std::string &data)
+static std::shared_ptr<const std::string_view> make_input(std::string data)
+{
+	// Keep the string and a view of it in the same allocation, so that the view can be shared like file mappings
+	struct input_string
+	{
+		std::string data;
+		std::string_view view;
+	};
+
+	const auto input = std::make_shared<input_string>();
+	input->data = std::move(data);
+	input->view = input->data;
+	return std::shared_ptr<const std::string_view>(input, &input->view);
+}
+
+static std::string_view skip_bom(std::string_view file_data)
+{
+	// Remove BOM (0xefbbbf means 0xfeff)
+	if (file_data.size() >= 3 &&
+		static_cast<unsigned char>(file_data[0]) == 0xef &&
+		static_cast<unsigned char>(file_data[1]) == 0xbb &&
+		static_cast<unsigned char>(file_data[2]) == 0xbf)
+		file_data.remove_prefix(3);
+	return file_data;
+}
+
+struct file_mapping_deleter
+{
+	void *mem;
+	size_t size;
+
+	void unmap() const
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mem);
+#else
+		munmap(mem, size + 1);
+#endif
+	}
+
+	void operator()(const std::string_view *view) const
+	{
+		unmap();
+		delete view;
+	}
+};
+
+static bool is_file_mapping(const std::shared_ptr<const std::string_view> &data)
 {
+	return std::get_deleter<file_mapping_deleter>(data) != nullptr;
+}
+
+static bool map_file(const std::filesystem::path &path, std::shared_ptr<const std::string_view> &data)
+{
+	// Mapping small files costs more than just reading them
+	const size_t min_mapping_size = 16 * 1024;
+
+#ifdef _WIN32
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER file_size = {};
+	SYSTEM_INFO system_info = {};
+	GetSystemInfo(&system_info);
+	const size_t page_size = system_info.dwPageSize;
+
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &file_size) && static_cast<uint64_t>(file_size.QuadPart) >= min_mapping_size && static_cast<uint64_t>(file_size.QuadPart) <= std::numeric_limits<size_t>::max())
+		mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+
+	// The mapping keeps a reference to the file, so can close the handle right away
+	CloseHandle(file);
+
+	if (mapping == nullptr)
+		return false;
+
+	const size_t size = static_cast<size_t>(file_size.QuadPart);
+	char *const mem = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+
+	CloseHandle(mapping);
+
+	if (mem == nullptr)
+		return false;
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat file_stat = {};
+	const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+	void *mapping = MAP_FAILED;
+	if (fstat(file, &file_stat) == 0 && static_cast<uintmax_t>(file_stat.st_size) >= min_mapping_size && static_cast<uintmax_t>(file_stat.st_size) <= std::numeric_limits<size_t>::max())
+		mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size) + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+
+	// The mapping keeps a reference to the file, so can close the descriptor right away
+	close(file);
+
+	if (mapping == MAP_FAILED)
+		return false;
+
+	const size_t size = static_cast<size_t>(file_stat.st_size);
+	char *const mem = static_cast<char *>(mapping);
+#endif
+
+	const file_mapping_deleter deleter = { mem, size };
+
+	// The lexer expects the input to end with a new line and be followed by null characters (it looks ahead up to two characters)
+	// The remainder of the last page of a mapping is filled with zeros, so can only use the mapping if there is enough space left in that page to append the new line
+	if (size % page_size == 0 || page_size - (size % page_size) < 4)
+	{
+		deleter.unmap();
+		return false;
+	}
+
+	// Mapping is copy-on-write, so this only copies the last page and does not modify the file
+	mem[size] = '\n';
+
+	// Mappings must not outlive the call that created them (see 'release_file_mappings'), so the deleter type is used to identify them later
+	data = std::shared_ptr<const std::string_view>(new std::string_view(skip_bom(std::string_view(mem, size + 1))), deleter);
+	return true;
+}
+
+static bool read_file(const std::filesystem::path &path, std::shared_ptr<const std::string_view> &data, bool allow_mapping = true)
+{
+	if (allow_mapping && map_file(path, data))
+		return true;
+
 #ifdef _WIN32
 	FILE *file = nullptr;
 	if (_wfopen_s(&file, path.c_str(), L"rb") != 0)
@@ -76,27 +214,204 @@ static bool read_file(const std::filesystem::path &path, std::string &data)
 #endif
 
 	// Read file contents into memory
-	std::vector<char> file_mem(static_cast<size_t>(std::filesystem::file_size(path) + 1));
-	const size_t eof = fread(file_mem.data(), 1, file_mem.size() - 1, file);
+	std::string file_data(static_cast<size_t>(std::filesystem::file_size(path) + 1), '\0');
+	const size_t eof = fread(file_data.data(), 1, file_data.size() - 1, file);
 
 	// Append a new line feed to the end of the input string to avoid issues with parsing
-	file_mem[eof] = '\n';
+	file_data.resize(eof + 1);
+	file_data[eof] = '\n';
 
 	// No longer need to have a handle open to the file, since all data was read, so can safely close it
 	fclose(file);
 
-	std::string_view file_data(file_mem.data(), file_mem.size());
+	file_data.erase(0, file_data.size() - skip_bom(file_data).size());
 
-	// Remove BOM (0xefbbbf means 0xfeff)
-	if (file_data.size() >= 3 &&
-		static_cast<unsigned char>(file_data[0]) == 0xef &&
-		static_cast<unsigned char>(file_data[1]) == 0xbb &&
-		static_cast<unsigned char>(file_data[2]) == 0xbf)
-		file_data = std::string_view(file_data.data() + 3, file_data.size() - 3);
+	data = make_input(std::move(file_data));
+	return true;
+}
+
+struct reshadefx::include_snapshot
+{
+	// State before processing the include file, which has to match for the snapshot to be reused
+	std::vector<std::filesystem::path> include_paths;
+	std::unordered_map<std::string, preprocessor::macro> macros_before;
+	// Contents of all files that were read while processing the include file (including itself), which must not have changed since
+	std::vector<std::pair<std::string, std::shared_ptr<const std::string_view>>> files;
+
+	// State after processing the include file
+	std::unordered_map<std::string, preprocessor::macro> macros_after;
+	std::vector<std::string> used_macros;
+	std::vector<std::string> once_files;
+	std::vector<std::pair<std::string, std::string>> include_guards;
+	std::string output;
+	source_map output_map; // Relative to the start of the output of the include file
+	std::string output_source;
+	unsigned int output_line = 0;
+};
+
+static bool parse_not_defined(std::string_view line, std::string &name)
+{
+	// Match exactly '!defined(name)' or '!defined name', surrounded by any amount of spaces or tabs (anything else, including comments, is rejected)
+	const auto skip_space = [&line]() {
+		while (!line.empty() && (line.front() == ' ' || line.front() == '\t' || line.front() == '\r'))
+			line.remove_prefix(1);
+	};
+	const auto accept = [&line, &skip_space](std::string_view text) {
+		skip_space();
+		if (line.substr(0, text.size()) != text)
+			return false;
+		line.remove_prefix(text.size());
+		return true;
+	};
+
+	if (!accept("!") || !accept("defined"))
+		return false;
+	if (!line.empty() && line.front() != ' ' && line.front() != '\t' && line.front() != '(')
+		return false; // Identifier continues after 'defined'
+	const bool parenthesized = accept("(");
+	skip_space();
+
+	size_t length = 0;
+	while (length < line.size() && (line[length] == '_' || (line[length] >= 'A' && line[length] <= 'Z') || (line[length] >= 'a' && line[length] <= 'z') || (length != 0 && line[length] >= '0' && line[length] <= '9')))
+		++length;
+	if (length == 0)
+		return false;
+	const std::string_view identifier = line.substr(0, length);
+	line.remove_prefix(length);
+
+	if (parenthesized && !accept(")"))
+		return false;
+	skip_space();
+	if (!line.empty())
+		return false;
+
+	name = identifier;
+	return true;
+}
+
+static bool has_concatenation(const std::string &replacement_list)
+{
+	const char concat_sequence[2] = { static_cast<char>(macro_replacement_start), static_cast<char>(macro_replacement_concat) };
+	return replacement_list.find(concat_sequence, 0, 2) != std::string::npos;
+}
+
+template <typename F>
+static void for_each_identifier(const std::string &replacement_list, F callback)
+{
+	for (size_t offset = 0; offset < replacement_list.size();)
+	{
+		const char c = replacement_list[offset];
+		if (c == macro_replacement_start)
+		{
+			// Skip special replacement sequences ('macro_replacement_concat' has no argument index)
+			offset += replacement_list[offset + 1] == macro_replacement_concat ? 2 : 3;
+		}
+		else if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_')
+		{
+			const size_t begin = offset;
+			while (++offset < replacement_list.size() && (
+				(replacement_list[offset] >= '0' && replacement_list[offset] <= '9') ||
+				(replacement_list[offset] >= 'A' && replacement_list[offset] <= 'Z') ||
+				(replacement_list[offset] >= 'a' && replacement_list[offset] <= 'z') || replacement_list[offset] == '_'))
+				continue;
+
+			callback(replacement_list.substr(begin, offset - begin));
+		}
+		else if (c >= '0' && c <= '9')
+		{
+			// Skip number literals, so that suffixes are not mistaken for identifiers
+			while (++offset < replacement_list.size() && (
+				(replacement_list[offset] >= '0' && replacement_list[offset] <= '9') ||
+				(replacement_list[offset] >= 'A' && replacement_list[offset] <= 'Z') ||
+				(replacement_list[offset] >= 'a' && replacement_list[offset] <= 'z') || replacement_list[offset] == '_' || replacement_list[offset] == '.'))
+				continue;
+		}
+		else
+		{
+			++offset;
+		}
+	}
+}
+
+static bool is_same_macro_table(const std::unordered_map<std::string, reshadefx::preprocessor::macro> &lhs, const std::unordered_map<std::string, reshadefx::preprocessor::macro> &rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (const auto &[name, lhs_macro] : lhs)
+	{
+		const auto it = rhs.find(name);
+		if (it == rhs.end())
+			return false;
+
+		const reshadefx::preprocessor::macro &rhs_macro = it->second;
+		if (lhs_macro.replacement_list != rhs_macro.replacement_list ||
+			lhs_macro.parameters != rhs_macro.parameters ||
+			lhs_macro.is_variadic != rhs_macro.is_variadic ||
+			lhs_macro.is_function_like != rhs_macro.is_function_like)
+			return false;
+	}
+
+	return true;
+}
+
+bool reshadefx::include_cache::read_file(const std::filesystem::path &path, std::shared_ptr<const std::string_view> &data)
+{
+	std::error_code ec;
+	const std::filesystem::file_time_type last_write_time = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return false;
+	const uintmax_t size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+
+	const std::string path_string = path.u8string();
+
+	{ const std::lock_guard<std::mutex> lock(_mutex);
+
+		if (const auto it = _files.find(path_string);
+			it != _files.end() && it->second.last_write_time == last_write_time && it->second.size == size)
+		{
+			data = it->second.data;
+			return true;
+		}
+	}
+
+	// Read the file without holding the lock, so that other threads are not blocked by disk access
+	// Do not map it into memory, since the cache may keep the data around for a long time, and a mapped file cannot be truncated (e.g. when saving it in an editor) on Windows
+	if (!::read_file(path, data, false))
+		return false;
+
+	const std::lock_guard<std::mutex> lock(_mutex);
+	_files[path_string] = { last_write_time, size, data };
 
-	data = file_data;
 	return true;
 }
+std::vector<std::shared_ptr<const reshadefx::include_snapshot>> reshadefx::include_cache::find_snapshots(const std::string &path)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	if (const auto it = _snapshots.find(path); it != _snapshots.end())
+		return it->second;
+	return {};
+}
+void reshadefx::include_cache::add_snapshot(const std::string &path, std::shared_ptr<const include_snapshot> snapshot)
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+
+	std::vector<std::shared_ptr<const include_snapshot>> &snapshots = _snapshots[path];
+	// Limit the number of different macro states that are kept per file, dropping the oldest one first
+	if (snapshots.size() >= 8)
+		snapshots.erase(snapshots.begin());
+	snapshots.push_back(std::move(snapshot));
+}
+
+void reshadefx::include_cache::clear()
+{
+	const std::lock_guard<std::mutex> lock(_mutex);
+	_files.clear();
+	_snapshots.clear();
+}
 
 static std::string escape_string(std::string s)
 {
@@ -125,7 +440,7 @@ bool reshadefx::preprocessor::add_macro_definition(const std::string &name, cons
 
 bool reshadefx::preprocessor::append_file(const std::filesystem::path &path)
 {
-	std::string data;
+	std::shared_ptr<const std::string_view> data;
 	if (!read_file(path, data))
 		return false;
 
@@ -134,6 +449,8 @@ bool reshadefx::preprocessor::append_file(const std::filesystem::path &path)
 	push(std::move(data), path.u8string());
 	parse();
 
+	release_file_mappings();
+
 	return _success;
 }
 bool reshadefx::preprocessor::append_string(const std::string &source_code)
@@ -151,6 +468,357 @@ bool reshadefx::preprocessor::append_string(const std::string &source_code)
 
 	return _success;
 }
+bool reshadefx::preprocessor::scan_file(const std::filesystem::path &path)
+{
+	std::shared_ptr<const std::string_view> data;
+	if (!read_file(path, data))
+		return false;
+
+	_success = true; // Clear success flag before scanning a new file
+	_scanning = true;
+
+	// Only macros that are defined before scanning can change the result, all others are defined by the scanned files themselves
+	_scan_external_macros.clear();
+	for (const auto &[name, macro] : _macros)
+		_scan_external_macros.insert(name);
+
+	push(std::move(data), path.u8string());
+	parse();
+
+	release_file_mappings();
+
+	_scanning = false;
+
+	return _success;
+}
+bool reshadefx::preprocessor::append_file_permutations(const std::filesystem::path &path, const std::vector<std::vector<std::pair<std::string, std::string>>> &permutations, std::vector<std::shared_ptr<preprocessor>> &results) const
+{
+	results.clear();
+
+	std::shared_ptr<const std::string_view> data;
+	if (!read_file(path, data))
+		return false;
+
+	std::vector<std::unordered_map<std::string, std::string>> permutation_macros(permutations.size());
+	for (size_t i = 0; i < permutations.size(); ++i)
+		for (const auto &[name, value] : permutations[i])
+			permutation_macros[i][name] = value;
+
+	results.resize(permutations.size());
+	bool success = true;
+
+	// Start with a single instance that processes all permutations, which is forked every time their output diverges
+	std::vector<std::unique_ptr<preprocessor>> pending;
+	{
+		std::unique_ptr<preprocessor> initial = clone();
+		initial->_success = true; // Clear success flag before parsing a new file
+		initial->_permutations = &permutation_macros;
+		for (size_t i = 0; i < permutations.size(); ++i)
+			initial->_permutation_indices.push_back(i);
+		initial->update_permutation_macros();
+		initial->push(std::move(data), path.u8string());
+		pending.push_back(std::move(initial));
+	}
+
+	while (!pending.empty())
+	{
+		std::unique_ptr<preprocessor> pp = std::move(pending.back());
+		pending.pop_back();
+
+		pp->parse();
+
+		if (pp->_permutation_fork)
+		{
+			pp->_permutation_fork = false;
+
+			// Split permutations into groups with the same definition of the macro that caused the fork (or of all differing macros if it is not known)
+			std::unordered_map<std::string, std::vector<size_t>> groups;
+			for (const size_t index : pp->_permutation_indices)
+			{
+				std::string key;
+				const auto append_key = [&key, &macros = permutation_macros[index]](const std::string &name) {
+					if (const auto it = macros.find(name); it != macros.end())
+						append_text(key, '=', it->second);
+					key += '\n';
+				};
+
+				if (!pp->_permutation_fork_macro.empty())
+					append_key(pp->_permutation_fork_macro);
+				else
+					for (const std::string &name : pp->_permutation_macros)
+						append_key(name);
+
+				groups[key].push_back(index);
+			}
+
+			for (auto it = groups.begin(); it != groups.end(); ++it)
+			{
+				// Reuse the existing instance for the last group, so that it does not have to be copied
+				std::unique_ptr<preprocessor> fork = std::next(it) == groups.end() ? std::move(pp) : pp->clone();
+				fork->_permutation_indices = std::move(it->second);
+				fork->update_permutation_macros();
+				pending.push_back(std::move(fork));
+			}
+			continue;
+		}
+
+		success &= pp->_success;
+
+		pp->_permutations = nullptr;
+		pp->release_file_mappings();
+		const std::shared_ptr<preprocessor> result = std::move(pp);
+		for (const size_t index : result->_permutation_indices)
+			results[index] = result;
+	}
+
+	return success;
+}
+
+std::unique_ptr<reshadefx::preprocessor> reshadefx::preprocessor::clone() const
+{
+	// Cannot copy a snapshot that is still being recorded, but those are not used while processing permutations anyway
+	assert(_snapshot == nullptr);
+
+	std::unique_ptr<preprocessor> result = std::make_unique<preprocessor>();
+	result->_success = _success;
+	result->_output = _output;
+	result->_output_map = _output_map;
+	result->_output_line_count = _output_line_count;
+	result->_output_line_count_offset = _output_line_count_offset;
+	result->_errors = _errors;
+	result->_current_token_raw_data = _current_token_raw_data; // The lexer input data is shared, so this stays valid
+	result->_token = _token;
+	result->_if_stack = _if_stack;
+	result->_input_stack.reserve(_input_stack.size());
+	for (const input_level &level : _input_stack)
+	{
+		input_level &level_copy = result->_input_stack.emplace_back();
+		level_copy.name = level.name;
+		level_copy.source_id = level.source_id;
+		level_copy.lexer.reset(new lexer(*level.lexer));
+		level_copy.lexer->set_source_table(&result->_sources);
+		level_copy.next_token = level.next_token;
+		level_copy.hidden_macro = level.hidden_macro;
+		level_copy.guard_macro = level.guard_macro;
+		level_copy.guard = level.guard;
+		level_copy.guard_if_index = level.guard_if_index;
+	}
+	result->_next_input_index = _next_input_index;
+	result->_current_input_index = _current_input_index;
+	result->_recursion_count = _recursion_count;
+	result->_output_location = _output_location;
+	result->_sources = _sources;
+	result->_used_macros = _used_macros;
+	result->_macros = _macros;
+	result->_include_paths = _include_paths;
+	result->_file_cache = _file_cache;
+	result->_include_guards = _include_guards;
+	result->_include_cache = _include_cache;
+	result->_permutations = _permutations;
+	result->_permutation_indices = _permutation_indices;
+	result->_permutation_line = _permutation_line;
+	return result;
+}
+
+void reshadefx::preprocessor::update_permutation_macros()
+{
+	_permutation_macros.clear();
+	_permutation_dependencies.clear();
+	_permutation_fork_macro.clear();
+
+	for (const size_t index : _permutation_indices)
+	{
+		for (const auto &[name, value] : (*_permutations)[index])
+		{
+			if (_permutation_macros.find(name) != _permutation_macros.end())
+				continue;
+
+			// Permutations that do not define the macro keep the existing definition
+			const auto first = (*_permutations)[_permutation_indices[0]].find(name);
+			const bool same_in_all = std::all_of(_permutation_indices.begin(), _permutation_indices.end(),
+				[this, &name, &first](size_t other_index) {
+					const auto it = (*_permutations)[other_index].find(name);
+					const auto end = (*_permutations)[other_index].end();
+					return (it == end) == (first == (*_permutations)[_permutation_indices[0]].end()) && (it == end || it->second == first->second);
+				});
+
+			if (!same_in_all)
+				_permutation_macros.insert(name);
+			else if (first != (*_permutations)[_permutation_indices[0]].end())
+				_macros[name] = macro { first->second, {} };
+		}
+	}
+}
+
+bool reshadefx::preprocessor::check_permutation_fork()
+{
+	if (_permutation_macros.empty() || _input_stack.empty())
+		return false;
+
+	const input_level &input = _input_stack[_next_input_index];
+	const bool skip = !_if_stack.empty() && _if_stack.back().skipping;
+
+	switch (input.next_token)
+	{
+	case tokenid::hash_elif:
+		// The condition is only evaluated if no previous branch was taken
+		if (_if_stack.empty() || _if_stack.back().value || (_if_stack.size() > 1 && _if_stack[_if_stack.size() - 2].skipping))
+			return false;
+		break;
+	case tokenid::hash_if:
+	case tokenid::hash_include:
+	case tokenid::hash_pragma:
+		if (skip)
+			return false;
+		break;
+	case tokenid::hash_ifdef:
+	case tokenid::hash_ifndef:
+	case tokenid::hash_def:
+	case tokenid::hash_undef:
+		if (skip)
+			return false;
+		else
+		{
+			// These only check or change the macro with the name that follows, but do not expand anything
+			lexer line_lexer(*input.lexer);
+			token name_token;
+			do
+				name_token = line_lexer.lex();
+			while (name_token == tokenid::space);
+
+			if (name_token == tokenid::identifier && _permutation_macros.find(name_token.literal_as_string) != _permutation_macros.end())
+			{
+				_permutation_fork_macro = name_token.literal_as_string;
+				return true;
+			}
+		}
+		return false;
+	case tokenid::identifier:
+		if (skip)
+			return false;
+		else
+		{
+			if (std::string dependency = find_permutation_dependency(input.next_token.literal_as_string); !dependency.empty())
+			{
+				_permutation_fork_macro = std::move(dependency);
+				return true;
+			}
+
+			const auto it = _macros.find(input.next_token.literal_as_string);
+			if (it == _macros.end() || !it->second.is_function_like)
+				return false;
+
+			// Arguments of a function-like macro invocation are expanded too, so check them as well (they may continue in the input levels below)
+			int parentheses_level = 0;
+			for (size_t input_index = _next_input_index + 1; input_index-- > 0;)
+			{
+				lexer peek_lexer(*_input_stack[input_index].lexer);
+				for (token tok = input_index == _next_input_index ? peek_lexer.lex() : _input_stack[input_index].next_token; tok != tokenid::end_of_file; tok = peek_lexer.lex())
+				{
+					if (parentheses_level == 0)
+					{
+						if (tok == tokenid::space)
+							continue;
+						if (tok != tokenid::parenthesis_open)
+							return false; // This is not a macro invocation
+					}
+
+					if (tok == tokenid::parenthesis_open)
+						parentheses_level++;
+					else if (tok == tokenid::parenthesis_close && --parentheses_level == 0)
+						return false;
+					else if (tok == tokenid::identifier)
+						if (std::string dependency = find_permutation_dependency(tok.literal_as_string); !dependency.empty())
+						{
+							_permutation_fork_macro = std::move(dependency);
+							return true;
+						}
+				}
+			}
+		}
+		return false;
+	default:
+		return false;
+	}
+
+	// Check all identifiers on the rest of the directive line, which may be expanded
+	std::unordered_set<std::string> visited_macros;
+	lexer line_lexer(*input.lexer);
+	for (token tok = line_lexer.lex(); tok != tokenid::end_of_line && tok != tokenid::end_of_file; tok = line_lexer.lex())
+	{
+		if (tok != tokenid::identifier)
+			continue;
+
+		if (std::string dependency = find_permutation_dependency(tok.literal_as_string); !dependency.empty())
+		{
+			_permutation_fork_macro = std::move(dependency);
+			return true;
+		}
+
+		// The whole line is evaluated at once, so names formed by token concatenation are expanded before they could be checked individually
+		// Those cannot be known without expanding the macro, so conservatively fork on all differing macros (an empty fork macro means all of them)
+		if (find_permutation_concatenation(tok.literal_as_string, visited_macros))
+		{
+			_permutation_fork_macro.clear();
+			return true;
+		}
+	}
+
+	// Whether an include file is skipped depends on its include guard being defined
+	if (input.next_token == tokenid::hash_include)
+	{
+		for (const auto &[file_path, guard_macro] : _include_guards)
+		{
+			if (_permutation_macros.find(guard_macro) != _permutation_macros.end())
+			{
+				_permutation_fork_macro = guard_macro;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+std::string reshadefx::preprocessor::find_permutation_dependency(const std::string &name)
+{
+	if (_permutation_macros.find(name) != _permutation_macros.end())
+		return name;
+
+	const auto it = _macros.find(name);
+	if (it == _macros.end())
+		return std::string();
+
+	if (const auto cache_it = _permutation_dependencies.find(name);
+		cache_it != _permutation_dependencies.end())
+		return cache_it->second;
+
+	// Add an empty entry first to stop recursion in case of cyclic macro references
+	std::string &dependency = _permutation_dependencies[name];
+
+	for_each_identifier(it->second.replacement_list, [this, &dependency](const std::string &identifier) {
+		if (dependency.empty())
+			dependency = find_permutation_dependency(identifier);
+	});
+
+	return dependency;
+}
+bool reshadefx::preprocessor::find_permutation_concatenation(const std::string &name, std::unordered_set<std::string> &visited_macros) const
+{
+	const auto it = _macros.find(name);
+	if (it == _macros.end() || !visited_macros.insert(name).second)
+		return false;
+
+	if (has_concatenation(it->second.replacement_list))
+		return true;
+
+	bool found = false;
+	for_each_identifier(it->second.replacement_list, [this, &found, &visited_macros](const std::string &identifier) {
+		found = found || find_permutation_concatenation(identifier, visited_macros);
+	});
+
+	return found;
+}
 
 std::vector<std::filesystem::path> reshadefx::preprocessor::included_files() const
 {
@@ -160,6 +828,31 @@ std::vector<std::filesystem::path> reshadefx::preprocessor::included_files() con
 		files.push_back(std::filesystem::u8path(it.first));
 	return files;
 }
+std::string reshadefx::preprocessor::output_with_line_directives() const
+{
+	std::string result;
+	result.reserve(_output.size() + _output_map.entries.size() * 16);
+
+	size_t offset = 0;
+	uint32_t source_id = 0;
+	for (const source_map::entry &entry : _output_map.entries)
+	{
+		result.append(_output, offset, entry.offset - offset);
+		offset = entry.offset;
+
+		append_text(result, "#line ", entry.line);
+		// Only add the file name when it changed, like the lexer expects
+		if (entry.source_id != source_id)
+			append_text(result, " \"", _output_map.sources[entry.source_id], '\"');
+		result += '\n';
+
+		source_id = entry.source_id;
+	}
+
+	result.append(_output, offset, std::string::npos);
+	return result;
+}
+
 std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_macro_definitions() const
 {
 	std::vector<std::pair<std::string, std::string>> defines;
@@ -172,26 +865,61 @@ std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_m
 	return defines;
 }
 
+std::vector<std::pair<std::filesystem::path, std::filesystem::path>> reshadefx::preprocessor::include_graph() const
+{
+	std::vector<std::pair<std::filesystem::path, std::filesystem::path>> graph;
+	graph.reserve(_include_graph.size());
+	for (const auto &[parent, child] : _include_graph)
+		graph.emplace_back(std::filesystem::u8path(parent), std::filesystem::u8path(child));
+	return graph;
+}
+std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::macro_dependencies() const
+{
+	return { _macro_dependencies.begin(), _macro_dependencies.end() };
+}
+
 void reshadefx::preprocessor::error(const location &location, const std::string &message)
 {
-	_errors += location.source + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor error: " + message + '\n';
+	append_text(_errors, _sources[location], '(', location.line, ", ", location.column, "): preprocessor error: ", message, '\n');
 	_success = false; // Unset success flag
 }
 void reshadefx::preprocessor::warning(const location &location, const std::string &message)
 {
-	_errors += location.source + '(' + std::to_string(location.line) + ", " + std::to_string(location.column) + ')' + ": preprocessor warning: " + message + '\n';
+	append_text(_errors, _sources[location], '(', location.line, ", ", location.column, "): preprocessor warning: ", message, '\n');
+}
+
+void reshadefx::preprocessor::add_source_map_entry(unsigned int line, uint32_t source_id)
+{
+	_output_map.entries.push_back({ _output.size(), output_line_count(), line, source_id });
+}
+unsigned int reshadefx::preprocessor::output_line_count()
+{
+	// Only count the lines that were added since the last call, so that the output is scanned just once overall
+	_output_line_count += static_cast<unsigned int>(std::count(_output.begin() + _output_line_count_offset, _output.end(), '\n'));
+	_output_line_count_offset = _output.size();
+	return _output_line_count;
 }
 
 void reshadefx::preprocessor::push(std::string input, const std::string &name)
+{
+	push(make_input(std::move(input)), name);
+}
+void reshadefx::preprocessor::push(std::shared_ptr<const std::string_view> input, const std::string &name)
 {
 	location start_location = !name.empty() ?
 		// Start at the beginning of the file when pushing a new file
-		location(name, 1) :
+		location(_sources.intern(name), 1, 1) :
 		// Start with last known token location when pushing an unnamed string
 		_token.location;
 
-	input_level level = { name };
-	level.lexer.reset(new lexer(
+	input_level level = {};
+	level.name = name;
+	level.source_id = start_location.source_id;
+
+	// The lexer only borrows the input string, so that file contents can be shared with the file cache without copying them
+	const std::string_view input_view = *input;
+	const lexer input_lexer(
+		input_view,
 		std::move(input),
 		true  /* ignore_comments */,
 		false /* ignore_whitespace */,
@@ -199,13 +927,23 @@ void reshadefx::preprocessor::push(std::string input, const std::string &name)
 		false /* ignore_line_directives */,
 		true  /* ignore_keywords */,
 		false /* escape_string_literals */,
-		start_location));
+		start_location);
+	// Reuse lexer objects from previous input levels, since a new one is needed for every macro expansion
+	if (!_lexer_pool.empty())
+	{
+		level.lexer = std::move(_lexer_pool.back());
+		_lexer_pool.pop_back();
+		*level.lexer = input_lexer;
+	}
+	else
+	{
+		level.lexer.reset(new lexer(input_lexer));
+	}
+	level.lexer->set_source_table(&_sources);
 	level.next_token.id = tokenid::unknown;
 	level.next_token.location = start_location; // This is used in 'consume' to initialize the output location
-
-	// Inherit hidden macros from parent
-	if (!_input_stack.empty())
-		level.hidden_macros = _input_stack.back().hidden_macros;
+	// Only files can have an include guard, not macro expansions
+	level.guard = name.empty() ? guard_state::none : guard_state::start;
 
 	_input_stack.push_back(std::move(level));
 	_next_input_index = _input_stack.size() - 1;
@@ -214,12 +952,39 @@ void reshadefx::preprocessor::push(std::string input, const std::string &name)
 	consume();
 }
 
+void reshadefx::preprocessor::pop()
+{
+	_lexer_pool.push_back(std::move(_input_stack.back().lexer));
+	_input_stack.pop_back();
+}
+
+void reshadefx::preprocessor::release_file_mappings()
+{
+	// A mapping of a file that is truncated afterwards causes access violations and on Windows prevents the file from being saved, so it must not be kept beyond the current call
+	// Lexers that are left over after parsing finished (including the pooled ones) still reference their input, so drop them, the pool only pays off within a call anyway
+	while (!_input_stack.empty())
+		pop();
+	_lexer_pool.clear();
+	_next_input_index = 0;
+	_current_input_index = 0;
+	_current_token_raw_data = std::string_view();
+
+	// Copy contents of mapped include files into memory owned by the file cache, so that they can still be used by later calls
+	for (auto &[file_path, data] : _file_cache)
+		if (is_file_mapping(data))
+			data = make_input(std::string(*data));
+}
+
 bool reshadefx::preprocessor::peek(tokenid token) const
 {
 	return _input_stack[_next_input_index].next_token == token;
 }
 bool reshadefx::preprocessor::consume()
 {
+	// Check if the include file that is being recorded was fully processed, now that its last token was handled
+	if (_snapshot != nullptr && _next_input_index < _snapshot_input_index)
+		finish_include_snapshot();
+
 	_current_input_index = _next_input_index;
 
 	if (_input_stack.empty())
@@ -231,15 +996,16 @@ bool reshadefx::preprocessor::consume()
 
 	// Clear out input stack, now that the current token is overwritten
 	while (_input_stack.size() > (_current_input_index + 1))
-		_input_stack.pop_back();
+		pop();
 
 	// Update location information after switching input levels
 	input_level &input = _input_stack[_current_input_index];
-	if (!input.name.empty() && input.name != _output_location.source)
+	if (!input.name.empty() && input.source_id != _output_location.source_id)
 	{
-		_output += "#line " + std::to_string(input.next_token.location.line) + " \"" + input.name + "\"\n";
+		if (!_scanning)
+			add_source_map_entry(input.next_token.location.line, _output_map.sources.intern(input.name));
 		_output_location.line = input.next_token.location.line;
-		_output_location.source = input.name;
+		_output_location.source_id = input.source_id;
 	}
 
 	// Set current token
@@ -261,10 +1027,14 @@ bool reshadefx::preprocessor::consume()
 		for (; !_if_stack.empty() && _if_stack.back().input_index >= _next_input_index; _if_stack.pop_back())
 			error(_if_stack.back().pp_token.location, "unterminated #if");
 
+		// Remember the include guard of a file that was fully surrounded by one, so that it can be skipped when included again
+		if (const input_level &input = _input_stack[_next_input_index]; input.guard == guard_state::closed)
+			_include_guards[input.name] = input.guard_macro;
+
 		if (_next_input_index == 0)
 		{
 			// End of input has been reached, so cannot pop further and this is the last token
-			_input_stack.pop_back();
+			pop();
 			return false;
 		}
 		else
@@ -303,10 +1073,10 @@ bool reshadefx::preprocessor::expect(tokenid token)
 	if (!accept(token))
 	{
 		auto actual_token = _input_stack[_next_input_index].next_token;
-		actual_token.location.source = _output_location.source;
+		actual_token.location.source_id = _output_location.source_id;
 
 		error(actual_token.location, "syntax error: unexpected token '" +
-			_input_stack[_next_input_index].lexer->input_string().substr(actual_token.offset, actual_token.length) + '\'');
+			std::string(_input_stack[_next_input_index].lexer->input_string().substr(actual_token.offset, actual_token.length)) + '\'');
 
 		return false;
 	}
@@ -316,12 +1086,33 @@ bool reshadefx::preprocessor::expect(tokenid token)
 
 void reshadefx::preprocessor::parse()
 {
-	std::string line;
+	// Continue the line that was being processed before forking into permutations
+	std::string line = std::move(_permutation_line);
+	_permutation_line.clear();
 
-	while (consume())
+	while (true)
 	{
+		// Stop before the next token if its result would be different between the permutations, so that they can be forked from this point
+		if (_permutations != nullptr && check_permutation_fork())
+		{
+			_permutation_fork = true;
+			_permutation_line = std::move(line);
+			return;
+		}
+
+		if (!consume())
+			break;
+
 		_recursion_count = 0;
 
+		// Any token other than white space before the '#ifndef' (or '#if !defined') or after the '#endif' of an include guard means it does not surround the entire file
+		if (input_level &input = _input_stack[_current_input_index];
+			(input.guard == guard_state::start && _token != tokenid::hash_ifndef && _token != tokenid::hash_if) || input.guard == guard_state::closed)
+		{
+			if (_token != tokenid::space && _token != tokenid::end_of_line)
+				input.guard = guard_state::none;
+		}
+
 		const bool skip = !_if_stack.empty() && _if_stack.back().skipping;
 
 		switch (_token)
@@ -404,7 +1195,7 @@ void reshadefx::preprocessor::parse()
 			_output_location.line++;
 			if (_output_location.line != _token.location.line)
 			{
-				_output += "#line " + std::to_string(_token.location.line) + '\n';
+				add_source_map_entry(_token.location.line, _output_map.entries.empty() ? 0 : _output_map.entries.back().source_id);
 				_output_location.line  = _token.location.line;
 			}
 			_output += line;
@@ -412,15 +1203,26 @@ void reshadefx::preprocessor::parse()
 			line.clear();
 			continue;
 		case tokenid::identifier:
+			if (_scanning)
+			{
+				// Only keep track of the macros that would have been expanded here, instead of actually expanding them
+				add_macro_dependency(_token.literal_as_string, true);
+				continue;
+			}
 			if (evaluate_identifier_as_macro())
 				continue;
 			// fall through
 		default:
-			line += _current_token_raw_data;
+			// No output is generated when scanning for dependencies
+			if (!_scanning)
+				line += _current_token_raw_data;
 			break;
 		}
 	}
 
+	if (_scanning)
+		return;
+
 	// Append the last line after the EOF was reached to the output
 	_output += line;
 	_output += '\n';
@@ -471,6 +1273,10 @@ void reshadefx::preprocessor::parse_def()
 
 	if (!add_macro_definition(macro_name, m))
 		return error(location, "redefinition of '" + macro_name + "'");
+
+	// Macros that were already checked for dependencies may refer to this new macro, so have to check them again
+	_scan_visited_macros.clear();
+	_permutation_dependencies.clear();
 }
 void reshadefx::preprocessor::parse_undef()
 {
@@ -479,6 +1285,16 @@ void reshadefx::preprocessor::parse_undef()
 	else if (_token.literal_as_string == "defined")
 		return warning(_token.location, "macro name 'defined' is reserved");
 
+	_permutation_dependencies.clear();
+
+	if (_scanning)
+	{
+		// The macro definition before scanning no longer affects anything after it was removed
+		add_macro_dependency(_token.literal_as_string, false);
+		_scan_external_macros.erase(_token.literal_as_string);
+		_scan_visited_macros.clear();
+	}
+
 	_macros.erase(_token.literal_as_string);
 }
 
@@ -488,6 +1304,21 @@ void reshadefx::preprocessor::parse_if()
 	level.pp_token = _token;
 	level.input_index = _current_input_index;
 
+	// An '#if !defined(X)' at the very beginning of a file may be an include guard too, so check the rest of the line for exactly that form before it is consumed
+	if (input_level &input = _input_stack[_current_input_index]; input.guard == guard_state::start)
+	{
+		const std::string_view condition = input.lexer->input_string().substr(input.next_token.offset);
+		if (parse_not_defined(condition.substr(0, condition.find('\n')), input.guard_macro))
+		{
+			input.guard = guard_state::inside;
+			input.guard_if_index = _if_stack.size();
+		}
+		else
+		{
+			input.guard = guard_state::none;
+		}
+	}
+
 	// Evaluate expression after updating 'pp_token', so that it points at the beginning # token
 	level.value = evaluate_expression();
 
@@ -517,7 +1348,13 @@ void reshadefx::preprocessor::parse_ifdef()
 
 	_if_stack.push_back(std::move(level));
 	if (!parent_skipping) // Only add if this #ifdef is active
+	{
+		if (_scanning)
+			add_macro_dependency(_token.literal_as_string, false);
 		_used_macros.emplace(_token.literal_as_string);
+		if (_snapshot != nullptr)
+			_snapshot->used_macros.push_back(_token.literal_as_string);
+	}
 }
 void reshadefx::preprocessor::parse_ifndef()
 {
@@ -537,9 +1374,23 @@ void reshadefx::preprocessor::parse_ifndef()
 	const bool parent_skipping = !_if_stack.empty() && _if_stack.back().skipping;
 	level.skipping = parent_skipping || !level.value;
 
+	// An '#ifndef' at the very beginning of a file may be an include guard
+	if (input_level &input = _input_stack[_current_input_index]; input.guard == guard_state::start)
+	{
+		input.guard = guard_state::inside;
+		input.guard_macro = _token.literal_as_string;
+		input.guard_if_index = _if_stack.size();
+	}
+
 	_if_stack.push_back(std::move(level));
 	if (!parent_skipping) // Only add if this #ifndef is active
+	{
+		if (_scanning)
+			add_macro_dependency(_token.literal_as_string, false);
 		_used_macros.emplace(_token.literal_as_string);
+		if (_snapshot != nullptr)
+			_snapshot->used_macros.push_back(_token.literal_as_string);
+	}
 }
 void reshadefx::preprocessor::parse_elif()
 {
@@ -554,6 +1405,10 @@ void reshadefx::preprocessor::parse_elif()
 	level.pp_token = _token;
 	level.input_index = _current_input_index;
 
+	// Include guards cannot have alternative branches
+	if (input_level &input = _input_stack[_current_input_index]; input.guard == guard_state::inside && input.guard_if_index == _if_stack.size() - 1)
+		input.guard = guard_state::none;
+
 	const bool parent_skipping = _if_stack.size() > 1 && _if_stack[_if_stack.size() - 2].skipping;
 	const bool condition_result = evaluate_expression();
 	level.skipping = parent_skipping || level.value || !condition_result;
@@ -572,6 +1427,9 @@ void reshadefx::preprocessor::parse_else()
 	level.pp_token = _token;
 	level.input_index = _current_input_index;
 
+	if (input_level &input = _input_stack[_current_input_index]; input.guard == guard_state::inside && input.guard_if_index == _if_stack.size() - 1)
+		input.guard = guard_state::none;
+
 	const bool parent_skipping = _if_stack.size() > 1 && _if_stack[_if_stack.size() - 2].skipping;
 	level.skipping = parent_skipping || level.value;
 
@@ -580,9 +1438,12 @@ void reshadefx::preprocessor::parse_else()
 void reshadefx::preprocessor::parse_endif()
 {
 	if (_if_stack.empty())
-		error(_token.location, "missing #if for #endif");
-	else
-		_if_stack.pop_back();
+		return error(_token.location, "missing #if for #endif");
+
+	_if_stack.pop_back();
+
+	if (input_level &input = _input_stack[_current_input_index]; input.guard == guard_state::inside && input.guard_if_index == _if_stack.size())
+		input.guard = guard_state::closed;
 }
 
 void reshadefx::preprocessor::parse_error()
@@ -620,8 +1481,8 @@ void reshadefx::preprocessor::parse_pragma()
 
 	if (pragma == "once")
 	{
-		if (const auto it = _file_cache.find(_output_location.source); it != _file_cache.end())
-			it->second.clear();
+		if (const auto it = _file_cache.find(_sources[_output_location]); it != _file_cache.end())
+			it->second = make_input(std::string()); // Lexers that are still working on the file keep their own reference to the data
 		return;
 	}
 
@@ -649,7 +1510,7 @@ void reshadefx::preprocessor::parse_include()
 	}
 
 	std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
-	std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
+	std::filesystem::path file_path = std::filesystem::u8path(_sources[_output_location]);
 	file_path.replace_filename(file_name);
 
 	if (std::error_code ec; !std::filesystem::exists(file_path, ec))
@@ -667,15 +1528,47 @@ void reshadefx::preprocessor::parse_include()
 		return;
 	}
 
-	std::string data;
+	if (_scanning)
+		_include_graph.emplace_back(_sources[_output_location], file_path_string);
+
+	std::shared_ptr<const std::string_view> data;
 	if (auto it = _file_cache.find(file_path_string);
 		it != _file_cache.end())
 	{
-		data = it->second;
+		data = it->second; // Only copies the reference, the file contents are shared with the cache
+
+		// Skip the include file without lexing it again if it was marked with '#pragma once' (in which case it is stored as an empty string) or its include guard is still defined
+		const auto guard_it = _include_guards.find(file_path_string);
+		if (data->empty() || (guard_it != _include_guards.end() && _macros.find(guard_it->second) != _macros.end()))
+		{
+			if (guard_it != _include_guards.end())
+			{
+				// Mark the guard as used, same as the '#ifndef' would have
+				if (_scanning)
+					add_macro_dependency(guard_it->second, false);
+				_used_macros.emplace(guard_it->second);
+				if (_snapshot != nullptr)
+					_snapshot->used_macros.push_back(guard_it->second);
+			}
+
+			if (_snapshot != nullptr && std::find_if(_snapshot->files.begin(), _snapshot->files.end(),
+				[&file_path_string](const auto &file) { return file.first == file_path_string; }) == _snapshot->files.end())
+				_snapshot->files.emplace_back(file_path_string, std::move(data));
+			return;
+		}
 	}
-	else
+
+	// Snapshots can only be used if no macros are hidden, since those would affect the result of processing the include file
+	const bool use_snapshots = _include_cache != nullptr && !_scanning && _permutations == nullptr && std::find_if(_input_stack.begin(), _input_stack.begin() + _next_input_index + 1,
+		[](const input_level &level) { return !level.hidden_macro.empty(); }) == _input_stack.begin() + _next_input_index + 1;
+
+	// Skip processing the include file entirely if there is a matching snapshot in the cache already
+	if (use_snapshots && apply_include_snapshot(file_path_string))
+		return;
+
+	if (data == nullptr)
 	{
-		if (!read_file(file_path, data))
+		if (_include_cache != nullptr ? !_include_cache->read_file(file_path, data) : !read_file(file_path, data))
 		{
 			error(keyword_location, "could not open included file '" + file_path_string + '\'');
 			consume_until(tokenid::end_of_line);
@@ -687,10 +1580,135 @@ void reshadefx::preprocessor::parse_include()
 
 	// Clear out input stack before pushing include so that hidden macros do not bleed into the include
 	while (_input_stack.size() > (_next_input_index + 1))
-		_input_stack.pop_back();
+		pop();
+
+	if (_snapshot != nullptr)
+	{
+		// Keep track of all files that are included while recording a snapshot, so that changes to them can be detected
+		// Only the first time a file is included matters, since it is in the file cache afterwards
+		if (std::find_if(_snapshot->files.begin(), _snapshot->files.end(),
+			[&file_path_string](const auto &file) { return file.first == file_path_string; }) == _snapshot->files.end())
+			_snapshot->files.emplace_back(file_path_string, data);
+	}
+	else if (use_snapshots)
+	{
+		// Start recording a snapshot of the state after this include file, which is finished in 'consume' after its last token was handled
+		_snapshot = std::make_shared<include_snapshot>();
+		_snapshot->include_paths = _include_paths;
+		_snapshot->macros_before = _macros;
+		_snapshot->files.emplace_back(file_path_string, data);
+		_snapshot_path = file_path_string;
+		_snapshot_input_index = _input_stack.size();
+		_snapshot_output_offset = _output.size();
+		_snapshot_output_line = output_line_count();
+		_snapshot_output_map_index = _output_map.entries.size();
+		_snapshot_errors_offset = _errors.size();
+	}
+
 	push(std::move(data), file_path_string);
 }
 
+bool reshadefx::preprocessor::apply_include_snapshot(const std::string &path)
+{
+	for (const std::shared_ptr<const include_snapshot> &snapshot : _include_cache->find_snapshots(path))
+	{
+		if (snapshot->include_paths != _include_paths || !is_same_macro_table(snapshot->macros_before, _macros))
+			continue;
+
+		// Verify that none of the files that were read while recording the snapshot have changed since
+		bool files_match = true;
+		for (const auto &[file_path, file_data] : snapshot->files)
+		{
+			std::shared_ptr<const std::string_view> data;
+			if (const auto it = _file_cache.find(file_path); it != _file_cache.end())
+				data = it->second;
+			else if (!_include_cache->read_file(std::filesystem::u8path(file_path), data))
+				data = nullptr;
+
+			// Files that were skipped due to #pragma once are stored as empty strings
+			if (data == nullptr || (data != file_data && !(data->empty() && file_data->empty())))
+			{
+				files_match = false;
+				break;
+			}
+		}
+
+		if (!files_match)
+			continue;
+
+		_macros = snapshot->macros_after;
+		_used_macros.insert(snapshot->used_macros.begin(), snapshot->used_macros.end());
+
+		for (const auto &[file_path, file_data] : snapshot->files)
+			_file_cache.emplace(file_path, file_data);
+		for (const std::string &file_path : snapshot->once_files)
+			_file_cache[file_path] = make_input(std::string());
+		_include_guards.insert(snapshot->include_guards.begin(), snapshot->include_guards.end());
+
+		const size_t output_offset = _output.size();
+		const unsigned int output_line = output_line_count();
+		_output += snapshot->output;
+		for (source_map::entry entry : snapshot->output_map.entries)
+		{
+			entry.offset += output_offset;
+			entry.output_line += output_line;
+			entry.source_id = _output_map.sources.intern(snapshot->output_map.sources[entry.source_id]);
+			_output_map.entries.push_back(entry);
+		}
+		_output_location.source_id = _sources.intern(snapshot->output_source);
+		_output_location.line = snapshot->output_line;
+
+		// Merge into the snapshot that is currently being recorded, if this include file is nested in another one
+		if (_snapshot != nullptr)
+		{
+			for (const auto &file : snapshot->files)
+				if (std::find_if(_snapshot->files.begin(), _snapshot->files.end(),
+					[&file](const auto &existing_file) { return existing_file.first == file.first; }) == _snapshot->files.end())
+					_snapshot->files.push_back(file);
+			_snapshot->used_macros.insert(_snapshot->used_macros.end(), snapshot->used_macros.begin(), snapshot->used_macros.end());
+		}
+
+		return true;
+	}
+
+	return false;
+}
+void reshadefx::preprocessor::finish_include_snapshot()
+{
+	const std::shared_ptr<include_snapshot> snapshot = std::move(_snapshot);
+
+	// Only store the snapshot if the include file was processed without any errors or warnings and ended on its own line
+	// A macro invocation with arguments continuing after the end of the include file would otherwise end up in the snapshot
+	if (_errors.size() != _snapshot_errors_offset || _token != tokenid::end_of_line || _recursion_count != 0)
+		return;
+
+	snapshot->macros_after = _macros;
+
+	for (const auto &[file_path, file_data] : snapshot->files)
+	{
+		if (const auto it = _file_cache.find(file_path);
+			it != _file_cache.end() && it->second->empty() && !file_data->empty())
+			snapshot->once_files.push_back(file_path);
+		if (const auto it = _include_guards.find(file_path);
+			it != _include_guards.end())
+			snapshot->include_guards.push_back(*it);
+	}
+
+	snapshot->output = _output.substr(_snapshot_output_offset);
+	for (size_t i = _snapshot_output_map_index; i < _output_map.entries.size(); ++i)
+	{
+		source_map::entry entry = _output_map.entries[i];
+		entry.offset -= _snapshot_output_offset;
+		entry.output_line -= _snapshot_output_line;
+		entry.source_id = snapshot->output_map.sources.intern(_output_map.sources[entry.source_id]);
+		snapshot->output_map.entries.push_back(entry);
+	}
+	snapshot->output_source = _sources[_output_location];
+	snapshot->output_line = _output_location.line;
+
+	_include_cache->add_snapshot(_snapshot_path, snapshot);
+}
+
 bool reshadefx::preprocessor::evaluate_expression()
 {
 	struct rpn_token
@@ -855,7 +1873,7 @@ bool reshadefx::preprocessor::evaluate_expression()
 				std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
 				if (has_parentheses && !expect(tokenid::parenthesis_close))
 					return false;
-				std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
+				std::filesystem::path file_path = std::filesystem::u8path(_sources[_output_location]);
 				file_path.replace_filename(file_name);
 
 				std::error_code ec;
@@ -876,6 +1894,9 @@ bool reshadefx::preprocessor::evaluate_expression()
 				if (has_parentheses && !expect(tokenid::parenthesis_close))
 					return false;
 
+				if (_scanning)
+					add_macro_dependency(macro_name, false);
+
 				rpn[rpn_index++] = { _macros.find(macro_name) != _macros.end() ? 1 : 0, false };
 				continue;
 			}
@@ -1039,18 +2060,18 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	}
 	if (_token.literal_as_string == "__FILE__")
 	{
-		push(escape_string(_token.location.source));
+		push(escape_string(_sources[_token.location]));
 		return true;
 	}
 	if (_token.literal_as_string == "__FILE_STEM__")
 	{
-		const std::filesystem::path file_stem = std::filesystem::u8path(_token.location.source).stem();
+		const std::filesystem::path file_stem = std::filesystem::u8path(_sources[_token.location]).stem();
 		push(escape_string(file_stem.u8string()));
 		return true;
 	}
 	if (_token.literal_as_string == "__FILE_NAME__")
 	{
-		const std::filesystem::path file_name = std::filesystem::u8path(_token.location.source).filename();
+		const std::filesystem::path file_name = std::filesystem::u8path(_sources[_token.location]).filename();
 		push(escape_string(file_name.u8string()));
 		return true;
 	}
@@ -1059,10 +2080,13 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	if (it == _macros.end())
 		return false;
 
-	const std::unordered_set<std::string> &hidden_macros = _input_stack[_current_input_index].hidden_macros;
-	if (hidden_macros.find(_token.literal_as_string) != hidden_macros.end())
+	if (is_hidden_macro(_token.literal_as_string))
 		return false;
 
+	// Identifiers in the replacement list go through here again after expansion, so no need to follow it
+	if (_scanning)
+		add_macro_dependency(it->first, false);
+
 	const auto macro_location = _token.location;
 	if (_recursion_count++ >= 256)
 	{
@@ -1122,6 +2146,7 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 		}
 	}
 
+	// The expansion is pushed as text and lexed again, rather than substituted as a token sequence, since adjacent substitutions and pastes can form new tokens that way
 	std::string input;
 	expand_macro(it->first, it->second, arguments, input);
 
@@ -1129,12 +2154,45 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	{
 		push(std::move(input));
 
-		_input_stack[_current_input_index].hidden_macros.insert(it->first);
+		_input_stack[_current_input_index].hidden_macro = it->first;
 	}
 
 	return true;
 }
 
+bool reshadefx::preprocessor::is_hidden_macro(const std::string &name) const
+{
+	// Each input level inherits the hidden macros of all levels below it, so walk down the stack instead of copying them into every level
+	for (size_t input_index = _current_input_index + 1; input_index-- > 0;)
+		if (_input_stack[input_index].hidden_macro == name)
+			return true;
+	return false;
+}
+
+void reshadefx::preprocessor::add_macro_dependency(const std::string &name, bool follow_replacement_list)
+{
+	const auto it = _macros.find(name);
+	if (it == _macros.end())
+		return;
+
+	if (_scan_external_macros.find(name) != _scan_external_macros.end())
+		_macro_dependencies.emplace(name, it->second.replacement_list);
+
+	if (!follow_replacement_list || !_scan_visited_macros.insert(name).second)
+		return;
+
+	// Names formed by token concatenation are not known without expanding the macro, so conservatively depend on all macros defined before scanning
+	if (has_concatenation(it->second.replacement_list))
+		for (const std::string &external_name : _scan_external_macros)
+			if (const auto external_it = _macros.find(external_name); external_it != _macros.end())
+				_macro_dependencies.emplace(external_name, external_it->second.replacement_list);
+
+	// Any macros referenced in the replacement list would be expanded as well
+	for_each_identifier(it->second.replacement_list, [this](const std::string &name) {
+		add_macro_dependency(name, true);
+	});
+}
+
 void reshadefx::preprocessor::expand_macro(const std::string &name, const macro &macro, const std::vector<std::string> &arguments, std::string &out)
 {
 	for (size_t offset = 0; offset < macro.replacement_list.size(); ++offset)
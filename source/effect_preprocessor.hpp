@@ -6,13 +6,56 @@
 #pragma once
 
 #include "effect_token.hpp"
-#include <memory> // std::unique_ptr
+#include <mutex>
+#include <memory> // std::unique_ptr, std::shared_ptr
 #include <filesystem>
 #include <unordered_set>
 #include <unordered_map>
 
 namespace reshadefx
 {
+	/// <summary>
+	/// A thread-safe cache of file contents, which can be shared between multiple preprocessor instances so that common include files are only read once.
+	/// Cached contents are validated against the last write time and size of the file on every access.
+	/// </summary>
+	class include_cache
+	{
+	public:
+		/// <summary>
+		/// Get the contents of the file at the specified <paramref name="path"/>, reading it from disk only if it is not in the cache yet or was modified since.
+		/// </summary>
+		/// <param name="path">The path to the file to read.</param>
+		/// <param name="data">The file contents, terminated by a new line.</param>
+		/// <returns>A boolean value indicating whether the file could be read or not.</returns>
+		bool read_file(const std::filesystem::path &path, std::shared_ptr<const std::string_view> &data);
+
+		/// <summary>
+		/// Get all snapshots of the preprocessor state after the specified include file was processed, which were stored in this cache.
+		/// </summary>
+		std::vector<std::shared_ptr<const struct include_snapshot>> find_snapshots(const std::string &path);
+		/// <summary>
+		/// Store a snapshot of the preprocessor state after the specified include file was processed, so that other preprocessor instances can skip processing it again.
+		/// </summary>
+		void add_snapshot(const std::string &path, std::shared_ptr<const struct include_snapshot> snapshot);
+
+		/// <summary>
+		/// Remove all files and snapshots from the cache.
+		/// </summary>
+		void clear();
+
+	private:
+		struct file_entry
+		{
+			std::filesystem::file_time_type last_write_time;
+			uintmax_t size;
+			std::shared_ptr<const std::string_view> data;
+		};
+
+		std::mutex _mutex;
+		std::unordered_map<std::string, file_entry> _files;
+		std::unordered_map<std::string, std::vector<std::shared_ptr<const struct include_snapshot>>> _snapshots;
+	};
+
 	/// <summary>
 	/// A C-style preprocessor implementation.
 	/// </summary>
@@ -37,6 +80,13 @@ namespace reshadefx
 		/// <param name="path">The path to the directory to add.</param>
 		void add_include_path(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Share included files with other preprocessor instances through the specified cache, instead of always reading them from disk.
+		/// This also reuses the result of processing an include file from the cache if the macro definitions before it are the same.
+		/// </summary>
+		/// <param name="cache">The cache to use, which has to stay alive as long as this preprocessor instance, or <see langword="nullptr"/> to disable it.</param>
+		void set_include_cache(include_cache *cache) { _include_cache = cache; }
+
 		/// <summary>
 		/// Add a new macro definition. This is equal to appending '#define name macro' to this preprocessor instance.
 		/// </summary>
@@ -67,6 +117,24 @@ namespace reshadefx
 		/// <param name="source_code">The string to parse.</param>
 		/// <returns>A boolean value indicating whether parsing was successful or not.</returns>
 		bool append_string(const std::string &source_code);
+		/// <summary>
+		/// Open the specified file and scan it for dependencies, without generating any output.
+		/// This only evaluates conditionals, macro definitions and #include directives, so is a lot cheaper than <see cref="append_file"/>.
+		/// Use <see cref="include_graph"/> and <see cref="macro_dependencies"/> afterwards to get the result.
+		/// </summary>
+		/// <param name="path">The path to the file to scan.</param>
+		/// <returns>A boolean value indicating whether scanning was successful or not.</returns>
+		bool scan_file(const std::filesystem::path &path);
+		/// <summary>
+		/// Open the specified file and parse it once for every permutation of additional macro definitions.
+		/// All work is shared between permutations up to the point where their output would diverge, instead of parsing the file from scratch for each.
+		/// Every permutation starts out from the state of this preprocessor instance, which is left unchanged.
+		/// </summary>
+		/// <param name="path">The path to the file to parse.</param>
+		/// <param name="permutations">The list of macro definitions (name and value) to add on top of the existing ones for each permutation.</param>
+		/// <param name="results">Receives a preprocessor instance with the output of each permutation. Permutations with identical output may share the same instance. Use <see cref="success"/> on each to check whether that permutation was parsed successfully.</param>
+		/// <returns>A boolean value indicating whether parsing was successful or not for all permutations.</returns>
+		bool append_file_permutations(const std::filesystem::path &path, const std::vector<std::vector<std::pair<std::string, std::string>>> &permutations, std::vector<std::shared_ptr<preprocessor>> &results) const;
 
 		/// <summary>
 		/// Get the list of error messages.
@@ -74,10 +142,23 @@ namespace reshadefx
 		std::string &errors() { return _errors; }
 		const std::string &errors() const { return _errors; }
 		/// <summary>
+		/// Get whether all input appended so far was parsed successfully.
+		/// </summary>
+		bool success() const { return _success; }
+		/// <summary>
 		/// Get the current pre-processed output string.
 		/// </summary>
 		std::string &output() { return _output; }
 		const std::string &output() const { return _output; }
+		/// <summary>
+		/// Get the map from lines in the pre-processed output string back to the source file locations they originated from.
+		/// The output string itself does not contain any #line directives, so pass this to <see cref="parser::parse"/> along with it to get correct code locations.
+		/// </summary>
+		const source_map &output_source_map() const { return _output_map; }
+		/// <summary>
+		/// Get a copy of the current pre-processed output string with the source file locations embedded as #line directives, so that it can be saved and parsed on its own.
+		/// </summary>
+		std::string output_with_line_directives() const;
 
 		/// <summary>
 		/// Get a list of all included files.
@@ -90,6 +171,17 @@ namespace reshadefx
 		/// <returns></returns>
 		std::vector<std::pair<std::string, std::string>> used_macro_definitions() const;
 
+		/// <summary>
+		/// Get the list of all #include directives that were encountered by <see cref="scan_file"/>, as pairs of the including file and the included file.
+		/// </summary>
+		std::vector<std::pair<std::filesystem::path, std::filesystem::path>> include_graph() const;
+		/// <summary>
+		/// Get the list of all macros defined before <see cref="scan_file"/> was called that the pre-processed output depends on, along with their replacement lists.
+		/// Macros that did not affect the result of any conditional and were not referenced from any text or other macro are not part of it.
+		/// Macro names formed by token concatenation cannot be known without expanding them, so if a macro using it is referenced, all macros defined before scanning are included.
+		/// </summary>
+		std::vector<std::pair<std::string, std::string>> macro_dependencies() const;
+
 	private:
 		struct if_level
 		{
@@ -98,18 +190,36 @@ namespace reshadefx
 			token pp_token;
 			size_t input_index;
 		};
+		enum class guard_state : uint8_t
+		{
+			none, // File is not surrounded by an include guard
+			start, // Only white space was encountered so far
+			inside, // Inside the '#ifndef' (or '#if !defined') block of the include guard
+			closed, // After the '#endif' of the include guard
+		};
 		struct input_level
 		{
 			std::string name;
+			uint32_t source_id;
 			std::unique_ptr<class lexer> lexer;
 			token next_token;
-			std::unordered_set<std::string> hidden_macros;
+			std::string hidden_macro; // Name of the macro that is being expanded by this input level, which is hidden in it and all levels above
+			std::string guard_macro;
+			guard_state guard = guard_state::none;
+			size_t guard_if_index = 0;
 		};
 
 		void error(const location &location, const std::string &message);
 		void warning(const location &location, const std::string &message);
 
+		void add_source_map_entry(unsigned int line, uint32_t source_id);
+		unsigned int output_line_count();
+
 		void push(std::string input, const std::string &name = std::string());
+		void push(std::shared_ptr<const std::string_view> input, const std::string &name = std::string());
+
+		void pop();
+		void release_file_mappings();
 
 		bool peek(tokenid token) const;
 		bool consume();
@@ -131,25 +241,62 @@ namespace reshadefx
 		void parse_pragma();
 		void parse_include();
 
+		bool apply_include_snapshot(const std::string &path);
+		void finish_include_snapshot();
+
 		bool evaluate_expression();
 		bool evaluate_identifier_as_macro();
+		bool is_hidden_macro(const std::string &name) const;
+		void add_macro_dependency(const std::string &name, bool follow_replacement_list);
+
+		std::unique_ptr<preprocessor> clone() const;
+		void update_permutation_macros();
+		bool check_permutation_fork();
+		std::string find_permutation_dependency(const std::string &name);
+		bool find_permutation_concatenation(const std::string &name, std::unordered_set<std::string> &visited_macros) const;
 
 		void expand_macro(const std::string &name, const macro &macro, const std::vector<std::string> &arguments, std::string &out);
 		void create_macro_replacement_list(macro &macro);
 
 		bool _success = true;
 		std::string _output, _errors;
-		std::string _current_token_raw_data;
+		std::string_view _current_token_raw_data;
 		reshadefx::token _token;
 		std::vector<if_level> _if_stack;
 		std::vector<input_level> _input_stack;
+		std::vector<std::unique_ptr<class lexer>> _lexer_pool;
 		size_t _next_input_index = 0;
 		size_t _current_input_index = 0;
 		unsigned short _recursion_count = 0;
 		location _output_location;
+		source_map _output_map;
+		unsigned int _output_line_count = 0;
+		size_t _output_line_count_offset = 0;
+		source_table _sources;
 		std::unordered_set<std::string> _used_macros;
 		std::unordered_map<std::string, macro> _macros;
 		std::vector<std::filesystem::path> _include_paths;
-		std::unordered_map<std::string, std::string> _file_cache;
+		std::unordered_map<std::string, std::shared_ptr<const std::string_view>> _file_cache;
+		std::unordered_map<std::string, std::string> _include_guards;
+		include_cache *_include_cache = nullptr;
+		std::shared_ptr<struct include_snapshot> _snapshot;
+		std::string _snapshot_path;
+		size_t _snapshot_input_index = 0;
+		size_t _snapshot_output_offset = 0;
+		unsigned int _snapshot_output_line = 0;
+		size_t _snapshot_output_map_index = 0;
+		size_t _snapshot_errors_offset = 0;
+		bool _scanning = false;
+		std::unordered_set<std::string> _scan_external_macros;
+		std::unordered_set<std::string> _scan_visited_macros;
+		std::unordered_map<std::string, std::string> _macro_dependencies;
+		std::vector<std::pair<std::string, std::string>> _include_graph;
+		const std::vector<std::unordered_map<std::string, std::string>> *_permutations = nullptr;
+		std::vector<size_t> _permutation_indices;
+		std::unordered_set<std::string> _permutation_macros; // Macros that are defined differently between the permutations processed by this instance
+		std::unordered_map<std::string, std::string> _permutation_dependencies;
+		std::string _permutation_fork_macro;
+		std::string _permutation_line;
+		bool _permutation_fork = false;
 	};
 }
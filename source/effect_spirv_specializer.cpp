@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_spirv_specializer.hpp"
+#include <unordered_map>
+
+// Use the C++ variant of the SPIR-V headers
+#include <spirv.hpp>
+
+bool reshadefx::specialize_spirv(module &module)
+{
+	const std::vector<uint32_t> &spirv = module.spirv;
+	if (spirv.size() < 5 || spirv[0] != spv::MagicNumber)
+		return false;
+
+	// Check that all specialization constants can be replaced before changing anything, and remember which IDs they were assigned
+	std::unordered_map<spv::Id, uint32_t> spec_ids;
+	std::unordered_map<spv::Id, uint32_t> scalar_widths;
+	for (size_t offset = 5, num_words; offset < spirv.size(); offset += num_words)
+	{
+		num_words = spirv[offset] >> spv::WordCountShift;
+		if (num_words == 0 || offset + num_words > spirv.size())
+			return false;
+
+		switch (static_cast<spv::Op>(spirv[offset] & spv::OpCodeMask))
+		{
+		case spv::OpDecorate:
+			if (num_words == 4 && spirv[offset + 2] == spv::DecorationSpecId)
+				spec_ids.emplace(spirv[offset + 1], spirv[offset + 3]);
+			break;
+		case spv::OpTypeInt:
+		case spv::OpTypeFloat:
+			if (num_words < 3)
+				return false;
+			scalar_widths.emplace(spirv[offset + 1], spirv[offset + 2]);
+			break;
+		case spv::OpSpecConstant:
+			// Types are declared before the constants using them, so the width is known at this point
+			if (const auto it = scalar_widths.find(num_words == 4 ? spirv[offset + 1] : 0);
+				it == scalar_widths.end() || it->second != 32)
+				return false;
+			break;
+		case spv::OpSpecConstantOp:
+			// The code generator never emits these, so there is no support for evaluating them
+			return false;
+		default:
+			break;
+		}
+	}
+
+	std::vector<uint32_t> specialized;
+	specialized.reserve(spirv.size());
+	specialized.insert(specialized.end(), spirv.begin(), spirv.begin() + 5);
+
+	for (size_t offset = 5, num_words; offset < spirv.size(); offset += num_words)
+	{
+		num_words = spirv[offset] >> spv::WordCountShift;
+		const spv::Op op = static_cast<spv::Op>(spirv[offset] & spv::OpCodeMask);
+
+		const size_t inst_offset = specialized.size();
+		specialized.insert(specialized.end(), spirv.begin() + offset, spirv.begin() + offset + num_words);
+
+		switch (op)
+		{
+		case spv::OpDecorate:
+			// Regular constants cannot have a specialization constant ID
+			if (num_words == 4 && spirv[offset + 2] == spv::DecorationSpecId)
+				specialized.resize(inst_offset);
+			break;
+		case spv::OpSpecConstantTrue:
+		case spv::OpSpecConstantFalse:
+		case spv::OpSpecConstant:
+		{
+			const bool is_boolean = op != spv::OpSpecConstant;
+
+			uint32_t value = is_boolean ? op == spv::OpSpecConstantTrue : spirv[offset + 3];
+			// Specialization constants without an entry keep their default value
+			if (const auto it = spec_ids.find(spirv[offset + 2]);
+				it != spec_ids.end() && it->second < module.spec_constants.size())
+				value = module.spec_constants[it->second].initializer_value.as_uint[0];
+
+			if (is_boolean)
+			{
+				specialized[inst_offset] = (spirv[offset] & ~spv::OpCodeMask) | (value != 0 ? spv::OpConstantTrue : spv::OpConstantFalse);
+			}
+			else
+			{
+				specialized[inst_offset] = (spirv[offset] & ~spv::OpCodeMask) | spv::OpConstant;
+				specialized[inst_offset + 3] = value;
+			}
+			break;
+		}
+		case spv::OpSpecConstantComposite:
+			// Definitions precede their uses, so all constituents were already turned into regular constants at this point
+			specialized[inst_offset] = (spirv[offset] & ~spv::OpCodeMask) | spv::OpConstantComposite;
+			break;
+		default:
+			break;
+		}
+	}
+
+	module.spirv = std::move(specialized);
+	module.spec_constants.clear();
+	return true;
+}
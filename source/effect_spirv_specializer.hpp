@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+
+namespace reshadefx
+{
+	/// <summary>
+	/// Replace all specialization constants in the SPIR-V code of a module with regular constants of the same type and result ID, so that the module no longer needs to be specialized at pipeline creation time.
+	/// Nothing else in the module is changed, folding the now constant expressions is left to the driver.
+	/// </summary>
+	/// <param name="module">The module to specialize in place. Each entry in <see cref="module::spec_constants"/> provides the value for the specialization constant with its index as ID in its initializer value (this is where the runtime stores the values from the current preset too). The list is cleared on success.</param>
+	/// <returns><see langword="true"/> if the module was specialized, <see langword="false"/> if it is malformed or contains specialization constants that are not 32-bit scalars or composites of them (in which case it is left unchanged).</returns>
+	bool specialize_spirv(module &module);
+}
@@ -6,23 +6,26 @@
 #include "effect_symbol_table.hpp"
 #include <cassert>
 #include <malloc.h> // alloca
-#include <algorithm> // std::upper_bound, std::sort
+#include <array>
+#include <algorithm> // std::upper_bound, std::equal_range, std::sort, std::remove_if
 
 #pragma region Import intrinsic functions
 
 struct intrinsic
 {
-	intrinsic(const char *name, unsigned int id, const reshadefx::type &ret_type, std::initializer_list<reshadefx::type> arg_types) : id(id)
+	constexpr intrinsic(std::string_view name, unsigned int id, const reshadefx::type &ret_type, std::initializer_list<reshadefx::type> arg_types) :
+		name(name), id(id), ret_type(ret_type), num_args(static_cast<unsigned int>(arg_types.size())), arg_types()
 	{
-		function.name = name;
-		function.return_type = ret_type;
-		function.parameter_list.reserve(arg_types.size());
+		unsigned int i = 0;
 		for (const reshadefx::type &arg_type : arg_types)
-			function.parameter_list.push_back({ arg_type, {}, {}, {} });
+			this->arg_types[i++] = arg_type;
 	}
 
+	std::string_view name;
 	unsigned int id;
-	reshadefx::function_info function;
+	reshadefx::type ret_type;
+	unsigned int num_args;
+	reshadefx::type arg_types[3];
 };
 
 // Import intrinsic callback functions
@@ -80,11 +83,31 @@ enum {
 #define storage { reshadefx::type::t_storage }
 
 // Import intrinsic function definitions
+// These are evaluated at compile time, so that no code has to run to set up the table when the module is loaded
 #define DEFINE_INTRINSIC(name, i, ret_type, ...) intrinsic(#name, name##i, ret_type, { __VA_ARGS__ }),
-static const intrinsic s_intrinsics[] = {
+static constexpr intrinsic s_intrinsics[] = {
 #include "effect_symbol_table_intrinsics.inl"
 };
 
+// List of indices into the intrinsic table, sorted by name and number of arguments, so that all overloads matching a call can be found with a binary search
+static constexpr auto s_intrinsic_index = []() {
+	std::array<uint16_t, std::size(s_intrinsics)> index = {};
+	for (size_t i = 0; i < index.size(); ++i)
+	{
+		// Insertion sort, which keeps overloads in the order they were defined in
+		size_t k = i;
+		for (; k > 0; --k)
+		{
+			const intrinsic &prev = s_intrinsics[index[k - 1]];
+			if (prev.name < s_intrinsics[i].name || (prev.name == s_intrinsics[i].name && prev.num_args <= s_intrinsics[i].num_args))
+				break;
+			index[k] = index[k - 1];
+		}
+		index[k] = static_cast<uint16_t>(i);
+	}
+	return index;
+}();
+
 #undef void
 #undef bool
 #undef bool2
@@ -173,22 +196,22 @@ void reshadefx::symbol_table::leave_scope()
 {
 	assert(_current_scope.level > 0);
 
-	for (auto &symbol : _symbol_stack)
+	// Only the symbol lists that had symbols inserted since entering this scope can contain any that need to be removed
+	while (!_scope_undo_log.empty() && _scope_undo_log.back().level >= _current_scope.level)
 	{
-		std::vector<scoped_symbol> &scope_list = symbol.second;
+		std::vector<scoped_symbol> &scope_list = *_scope_undo_log.back().symbols;
+		_scope_undo_log.pop_back();
 
-		for (auto scope_it = scope_list.begin(); scope_it != scope_list.end();)
-		{
-			if (scope_it->scope.level > scope_it->scope.namespace_level &&
-				scope_it->scope.level >= _current_scope.level)
-			{
-				scope_it = scope_list.erase(scope_it);
-			}
-			else
-			{
-				++scope_it;
-			}
-		}
+		scope_list.erase(std::remove_if(scope_list.begin(), scope_list.end(),
+			[this](const scoped_symbol &symbol) {
+				if (symbol.scope.level > symbol.scope.namespace_level && symbol.scope.level >= _current_scope.level)
+				{
+					if (symbol.op == symbol_type::function)
+						_function_call_cache.clear();
+					return true;
+				}
+				return false;
+			}), scope_list.end());
 	}
 
 	_current_scope.level--;
@@ -235,6 +258,10 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 			// Insert symbol into this scope
 			insert_sorted(_symbol_stack[previous_scope_name + name], scoped_symbol { symbol, scope });
 
+			// A new function overload may change the result of calls to that name resolved so far
+			if (symbol.op == symbol_type::function)
+				_function_call_cache.erase(previous_scope_name + name);
+
 			// Continue walking up the scope chain
 			scope.level = ++scope.namespace_level;
 		}
@@ -242,7 +269,15 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 	else
 	{
 		// This is a local symbol so it's sufficient to update the symbol stack with just the current scope
-		insert_sorted(_symbol_stack[name], scoped_symbol { symbol, _current_scope });
+		std::vector<scoped_symbol> &scope_list = _symbol_stack[name];
+		insert_sorted(scope_list, scoped_symbol { symbol, _current_scope });
+
+		// Symbols in a namespace scope stay around after leaving it, all others have to be removed again in 'leave_scope'
+		if (_current_scope.level > _current_scope.namespace_level)
+			_scope_undo_log.push_back({ &scope_list, _current_scope.level });
+
+		if (symbol.op == symbol_type::function)
+			_function_call_cache.erase(name);
 	}
 
 	return true;
@@ -281,63 +316,78 @@ reshadefx::scoped_symbol reshadefx::symbol_table::find_symbol(const std::string
 	return result;
 }
 
-static int compare_functions(const std::vector<reshadefx::expression> &arguments, const reshadefx::function_info *function1, const reshadefx::function_info *function2)
+template <typename F>
+static bool rank_arguments(const std::pmr::vector<reshadefx::expression> &arguments, F parameter_type, unsigned int *ranks)
 {
 	const size_t num_arguments = arguments.size();
 
-	// Check if the first function matches the argument types
-	bool function1_viable = true;
-	const auto function1_ranks = static_cast<unsigned int *>(alloca(num_arguments * sizeof(unsigned int)));
 	for (size_t i = 0; i < num_arguments; ++i)
-	{
-		if ((function1_ranks[i] = reshadefx::type::rank(arguments[i].type, function1->parameter_list[i].type)) == 0)
-		{
-			function1_viable = false;
-			break;
-		}
-	}
+		if ((ranks[i] = reshadefx::type::rank(arguments[i].type, parameter_type(i))) == 0)
+			return false; // The function is not viable if any argument cannot be converted
 
-	// Catch case where the second function does not exist
-	if (function2 == nullptr)
-		return function1_viable ? -1 : 1; // If the first function is not viable, this compare fails
+	// Sort ranks, so that functions are compared by their best matching arguments first
+	std::sort(ranks, ranks + num_arguments, std::greater<unsigned int>());
 
-	// Check if the second function matches the argument types
-	bool function2_viable = true;
-	const auto function2_ranks = static_cast<unsigned int *>(alloca(num_arguments * sizeof(unsigned int)));
+	return true;
+}
+static int compare_ranks(const unsigned int *ranks1, const unsigned int *ranks2, size_t num_arguments)
+{
 	for (size_t i = 0; i < num_arguments; ++i)
+		if (ranks1[i] > ranks2[i])
+			return -1; // Left function wins
+		else if (ranks2[i] > ranks1[i])
+			return +1; // Right function wins
+
+	return 0; // Both functions are equally viable
+}
+
+bool reshadefx::symbol_table::resolve_function_call(const std::string &name, const std::pmr::vector<expression> &arguments, const scope &scope, symbol &out_data, bool &is_ambiguous)
+{
+	// The result only depends on the function name, the scope and the argument types, so build a key out of the latter two
+	std::string &key = _function_call_key;
+	key.assign(scope.name);
+	const auto append_value = [&key](uint32_t value) { key.append(reinterpret_cast<const char *>(&value), sizeof(value)); };
+	append_value(scope.level);
+	append_value(scope.namespace_level);
+	for (const expression &argument : arguments)
 	{
-		if ((function2_ranks[i] = reshadefx::type::rank(arguments[i].type, function2->parameter_list[i].type)) == 0)
-		{
-			function2_viable = false;
-			break;
-		}
+		append_value(argument.type.base | (argument.type.rows << 8) | (argument.type.cols << 16));
+		append_value(static_cast<uint32_t>(argument.type.array_length));
+		append_value(argument.type.definition);
 	}
 
-	// If one of the functions is not viable, then the other one automatically wins
-	if (!function1_viable || !function2_viable)
-		return function2_viable - function1_viable;
+	std::unordered_map<std::string, function_call_result> &cache = _function_call_cache[name];
 
-	// Both functions are possible, so find the one with the higher ranking
-	std::sort(function1_ranks, function1_ranks + num_arguments, std::greater<unsigned int>());
-	std::sort(function2_ranks, function2_ranks + num_arguments, std::greater<unsigned int>());
+	if (const auto it = cache.find(key); it != cache.end())
+	{
+		out_data.op = it->second.op;
+		out_data.id = it->second.id;
+		out_data.type = it->second.type;
+		out_data.function = it->second.function;
+		is_ambiguous = it->second.ambiguous;
+		return it->second.success;
+	}
 
-	for (size_t i = 0; i < num_arguments; ++i)
-		if (function1_ranks[i] > function2_ranks[i])
-			return -1; // Left function wins
-		else if (function2_ranks[i] > function1_ranks[i])
-			return +1; // Right function wins
+	const bool success = resolve_function_call_uncached(name, arguments, scope, out_data, is_ambiguous);
 
-	return 0; // Both functions are equally viable
-}
+	cache.emplace(key, function_call_result { out_data.op, out_data.id, out_data.type, out_data.function, is_ambiguous, success });
 
-bool reshadefx::symbol_table::resolve_function_call(const std::string &name, const std::vector<expression> &arguments, const scope &scope, symbol &out_data, bool &is_ambiguous) const
+	return success;
+}
+bool reshadefx::symbol_table::resolve_function_call_uncached(const std::string &name, const std::pmr::vector<expression> &arguments, const scope &scope, symbol &out_data, bool &is_ambiguous)
 {
 	out_data.op = symbol_type::function;
 
 	const function_info *result = nullptr;
+	const intrinsic *result_intrinsic = nullptr;
 	unsigned int num_overloads = 0;
 	unsigned int overload_namespace = scope.namespace_level;
 
+	// Keep the ranks of the current result around, so that they do not have to be computed again for every comparison
+	const size_t num_arguments = arguments.size();
+	auto result_ranks = static_cast<unsigned int *>(alloca(num_arguments * sizeof(unsigned int)));
+	auto candidate_ranks = static_cast<unsigned int *>(alloca(num_arguments * sizeof(unsigned int)));
+
 	// Look up function name in the symbol stack and loop through the associated symbols
 	const auto stack_it = _symbol_stack.find(name);
 
@@ -371,13 +421,16 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 					continue;
 				}
 			}
-			else if (arguments.size() != function->parameter_list.size())
+			else if (num_arguments != function->parameter_list.size())
 			{
 				continue;
 			}
 
 			// A new possibly-matching function was found, compare it against the current result
-			const int comparison = compare_functions(arguments, function, result);
+			if (!rank_arguments(arguments, [function](size_t i) -> const type & { return function->parameter_list[i].type; }, candidate_ranks))
+				continue;
+
+			const int comparison = result != nullptr ? compare_ranks(candidate_ranks, result_ranks, num_arguments) : -1;
 
 			if (comparison < 0) // The new function is a better match
 			{
@@ -386,6 +439,7 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 				out_data.function = result = function;
 				num_overloads = 1;
 				overload_namespace = it->scope.namespace_level;
+				std::swap(result_ranks, candidate_ranks);
 			}
 			else if (comparison == 0 && overload_namespace == it->scope.namespace_level) // Both functions are equally viable, so the call is ambiguous
 			{
@@ -397,28 +451,54 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 	// Try matching against intrinsic functions if no matching user-defined function was found up to this point
 	if (num_overloads == 0)
 	{
-		for (const intrinsic &intrinsic : s_intrinsics)
+		const auto [first, last] = std::equal_range(s_intrinsic_index.begin(), s_intrinsic_index.end(), std::make_pair(std::string_view(name), static_cast<unsigned int>(num_arguments)),
+			[](const auto &lhs, const auto &rhs) {
+				if constexpr (std::is_same_v<std::decay_t<decltype(lhs)>, uint16_t>)
+					return std::make_pair(s_intrinsics[lhs].name, s_intrinsics[lhs].num_args) < rhs;
+				else
+					return lhs < std::make_pair(s_intrinsics[rhs].name, s_intrinsics[rhs].num_args);
+			});
+
+		for (auto index_it = first; index_it != last; ++index_it)
 		{
-			if (intrinsic.function.name != name || intrinsic.function.parameter_list.size() != arguments.size())
-				continue;
+			const intrinsic &intrinsic = s_intrinsics[*index_it];
 
 			// A new possibly-matching intrinsic function was found, compare it against the current result
-			const int comparison = compare_functions(arguments, &intrinsic.function, result);
+			if (!rank_arguments(arguments, [&intrinsic](size_t i) -> const type & { return intrinsic.arg_types[i]; }, candidate_ranks))
+				continue;
+
+			const int comparison = result_intrinsic != nullptr ? compare_ranks(candidate_ranks, result_ranks, num_arguments) : -1;
 
 			if (comparison < 0) // The new function is a better match
 			{
-				out_data.op = symbol_type::intrinsic;
-				out_data.id = intrinsic.id;
-				out_data.type = intrinsic.function.return_type;
-				out_data.function = &intrinsic.function;
-				result = out_data.function;
+				result_intrinsic = &intrinsic;
 				num_overloads = 1;
+				std::swap(result_ranks, candidate_ranks);
 			}
 			else if (comparison == 0 && overload_namespace == 0) // Both functions are equally viable, so the call is ambiguous (intrinsics are always in the global namespace)
 			{
 				++num_overloads;
 			}
 		}
+
+		if (result_intrinsic != nullptr)
+		{
+			out_data.op = symbol_type::intrinsic;
+			out_data.id = result_intrinsic->id;
+			out_data.type = result_intrinsic->ret_type;
+
+			// Only create a function description for intrinsics that are actually called
+			function_info &function = _intrinsic_functions[static_cast<uint32_t>(result_intrinsic - s_intrinsics)];
+			if (function.name.empty())
+			{
+				function.name = result_intrinsic->name;
+				function.return_type = result_intrinsic->ret_type;
+				function.parameter_list.reserve(result_intrinsic->num_args);
+				for (unsigned int i = 0; i < result_intrinsic->num_args; ++i)
+					function.parameter_list.push_back({ result_intrinsic->arg_types[i], {}, {}, {} });
+			}
+			out_data.function = &function;
+		}
 	}
 
 	is_ambiguous = num_overloads > 1;
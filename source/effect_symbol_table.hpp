@@ -7,6 +7,7 @@
 
 #include "effect_module.hpp"
 #include <unordered_map> // Used for symbol lookup table
+#include <memory_resource> // std::pmr::vector
 
 namespace reshadefx
 {
@@ -93,11 +94,35 @@ namespace reshadefx
 		/// <summary>
 		/// Search for the best function or intrinsic overload matching the argument list.
 		/// </summary>
-		bool resolve_function_call(const std::string &name, const std::vector<expression> &args, const scope &scope, symbol &data, bool &ambiguous) const;
+		bool resolve_function_call(const std::string &name, const std::pmr::vector<expression> &args, const scope &scope, symbol &data, bool &ambiguous);
 
 	private:
+		bool resolve_function_call_uncached(const std::string &name, const std::pmr::vector<expression> &args, const scope &scope, symbol &data, bool &ambiguous);
+
+		struct scope_undo_entry
+		{
+			std::vector<scoped_symbol> *symbols;
+			unsigned int level;
+		};
+
 		scope _current_scope;
 		std::unordered_map<std::string, // Lookup table from name to matching symbols
 			std::vector<scoped_symbol>> _symbol_stack;
+		std::vector<scope_undo_entry> _scope_undo_log; // List of symbols inserted into local scopes, so that leaving a scope only has to look at those
+		std::unordered_map<uint32_t, function_info> _intrinsic_functions; // Descriptions of the intrinsics that were resolved so far, by index into the intrinsic table
+
+		struct function_call_result
+		{
+			symbol_type op;
+			uint32_t id;
+			reshadefx::type type;
+			const reshadefx::function_info *function;
+			bool ambiguous;
+			bool success;
+		};
+
+		std::string _function_call_key;
+		std::unordered_map<std::string, // Results of previous function call resolutions, by function name and then by scope and argument types
+			std::unordered_map<std::string, function_call_result>> _function_call_cache;
 	};
 }
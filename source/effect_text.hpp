@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <limits>
+#include <cstring> // std::memcpy
+#include <charconv> // std::to_chars
+#include <type_traits>
+
+namespace reshadefx
+{
+	namespace detail
+	{
+		inline size_t max_text_length(char) { return 1; }
+		inline size_t max_text_length(std::string_view text) { return text.size(); }
+		template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+		constexpr size_t max_text_length(T) { return std::numeric_limits<T>::digits10 + 2; } // Number of digits plus sign
+
+		inline char *write_text(char *out, char c) { *out = c; return out + 1; }
+		inline char *write_text(char *out, std::string_view text) { std::memcpy(out, text.data(), text.size()); return out + text.size(); }
+		template <typename T, std::enable_if_t<std::is_integral_v<T>, int> = 0>
+		char *write_text(char *out, T value) { return std::to_chars(out, out + max_text_length(value), value).ptr; }
+	}
+
+	/// <summary>
+	/// Append any number of strings, characters and integer values to the specified string <paramref name="s"/>.
+	/// Unlike concatenating them with the '+' operator, this formats all pieces directly into the target, so does not create any temporary strings and grows the target at most once.
+	/// </summary>
+	template <typename... Args>
+	void append_text(std::string &s, const Args &... args)
+	{
+		const size_t offset = s.size();
+		s.resize(offset + (detail::max_text_length(args) + ...));
+
+		char *end = s.data() + offset;
+		((end = detail::write_text(end, args)), ...);
+
+		s.resize(end - s.data());
+	}
+}
@@ -5,8 +5,10 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -15,14 +17,80 @@ namespace reshadefx
 	/// </summary>
 	struct location
 	{
-		location() : line(1), column(1) {}
-		explicit location(unsigned int line, unsigned int column = 1) : line(line), column(column) {}
-		explicit location(std::string source, unsigned int line, unsigned int column = 1) : source(std::move(source)), line(line), column(column) {}
+		location() : source_id(0), line(1), column(1) {}
+		explicit location(unsigned int line, unsigned int column = 1) : source_id(0), line(line), column(column) {}
+		location(uint32_t source_id, unsigned int line, unsigned int column) : source_id(source_id), line(line), column(column) {}
 
-		std::string source;
+		/// <summary>
+		/// Index of the source file name in the <see cref="source_table"/> of the current compilation (zero if there is none).
+		/// </summary>
+		uint32_t source_id;
 		unsigned int line, column;
 	};
 
+	/// <summary>
+	/// A list of source file names, so that code locations only need to store a small index instead of a copy of the name.
+	/// </summary>
+	class source_table
+	{
+	public:
+		source_table() : _names(1) {} // Index zero is reserved for the empty name
+
+		/// <summary>
+		/// Get the index of the specified source file <paramref name="name"/>, adding it to the table if it does not exist yet.
+		/// </summary>
+		uint32_t intern(const std::string &name)
+		{
+			if (name.empty())
+				return 0;
+
+			if (const auto it = _lookup.find(name); it != _lookup.end())
+				return it->second;
+
+			const auto source_id = static_cast<uint32_t>(_names.size());
+			_lookup.emplace(name, source_id);
+			_names.push_back(name);
+			return source_id;
+		}
+
+		/// <summary>
+		/// Get the source file name for the specified index.
+		/// </summary>
+		const std::string &operator[](uint32_t source_id) const { return _names[source_id]; }
+
+		/// <summary>
+		/// Get the source file name of the specified code location.
+		/// </summary>
+		const std::string &operator[](const location &location) const { return _names[location.source_id]; }
+
+	private:
+		std::vector<std::string> _names;
+		std::unordered_map<std::string, uint32_t> _lookup;
+	};
+
+	/// <summary>
+	/// Maps lines of pre-processed output back to the source file locations they originated from, so that the output does not need to contain any #line directives.
+	/// </summary>
+	struct source_map
+	{
+		struct entry
+		{
+			size_t offset; // Byte offset in the output of the first line this entry applies to
+			unsigned int output_line; // Zero-based index of that line in the output
+			unsigned int line; // Line number in the source file of that line, subsequent lines count up from it
+			uint32_t source_id; // Index of the source file name in 'sources'
+		};
+
+		/// <summary>
+		/// List of entries, sorted by their position in the output. An entry applies to all lines up to the next one.
+		/// </summary>
+		std::vector<entry> entries;
+		/// <summary>
+		/// Source file names referenced by the entries.
+		/// </summary>
+		source_table sources;
+	};
+
 	/// <summary>
 	/// A collection of identifiers for various possible tokens.
 	/// </summary>
@@ -44,6 +44,9 @@ bool resolve_preset_path(std::filesystem::path &path)
 	return !resolve_path(path) || reshade::ini_file::load_cache(path).has({}, "Techniques");
 }
 
+// Include files are shared between all effects (and runtime instances), so only read them once instead of for every effect that includes them
+static reshadefx::include_cache s_include_cache;
+
 static bool find_file(const std::vector<std::filesystem::path> &search_paths, std::filesystem::path &path)
 {
 	std::error_code ec;
@@ -315,62 +318,53 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		}
 	}
 
-	bool source_cached = false; std::string source;
-	if (!effect.preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file, source_hash, source)) == false))
+	bool source_cached = false; std::string source; reshadefx::source_map source_map;
+	if (!effect.preprocessed)
 	{
-		reshadefx::preprocessor pp;
-		pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-		pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", _performance_mode ? "1" : "0");
-		pp.add_macro_definition("__VENDOR__", std::to_string(_vendor_id));
-		pp.add_macro_definition("__DEVICE__", std::to_string(_device_id));
-		pp.add_macro_definition("__RENDERER__", std::to_string(_renderer_id));
-		pp.add_macro_definition("__APPLICATION__", std::to_string( // Truncate hash to 32-bit, since lexer currently only supports 32-bit numbers anyway
-			std::hash<std::string>()(g_target_executable_path.stem().u8string()) & 0xFFFFFFFF));
-		pp.add_macro_definition("BUFFER_WIDTH", std::to_string(_width));
-		pp.add_macro_definition("BUFFER_HEIGHT", std::to_string(_height));
-		pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
-		pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
-		pp.add_macro_definition("BUFFER_COLOR_BIT_DEPTH", std::to_string(_color_bit_depth));
-
-		for (const std::string &definition : preprocessor_definitions)
-		{
-			if (definition.empty() || definition == "=")
-				continue; // Skip invalid definitions
-
-			const size_t equals_index = definition.find('=');
-			if (equals_index != std::string::npos)
-				pp.add_macro_definition(
-					definition.substr(0, equals_index),
-					definition.substr(equals_index + 1));
-			else
-				pp.add_macro_definition(definition);
-		}
-
-		for (const std::filesystem::path &include_path : include_paths)
-			pp.add_include_path(include_path);
-
-		// Add some conversion macros for compatibility with older versions of ReShade
-		pp.append_string(
-			"#define tex2Doffset(s, coords, offset) tex2D(s, coords, offset)\n"
-			"#define tex2Dlodoffset(s, coords, offset) tex2Dlod(s, coords, offset)\n"
-			"#define tex2Dgather(s, t, c) tex2Dgather##c(s, t)\n"
-			"#define tex2Dgatheroffset(s, t, o, c) tex2Dgather##c(s, t, o)\n"
-			"#define tex2Dgather0 tex2DgatherR\n"
-			"#define tex2Dgather1 tex2DgatherG\n"
-			"#define tex2Dgather2 tex2DgatherB\n"
-			"#define tex2Dgather3 tex2DgatherA\n");
-
-		// Load and preprocess the source file
-		effect.preprocessed = pp.append_file(source_file);
-
-		// Append preprocessor errors to the error list
-		effect.errors      += pp.errors();
-
-		if (effect.preprocessed)
-		{
-			source = std::move(pp.output());
-			source_cached = save_effect_cache(source_file, source_hash, source);
+		const auto initialize_preprocessor = [&](reshadefx::preprocessor &pp) {
+			pp.set_include_cache(&s_include_cache);
+			pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+			pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", _performance_mode ? "1" : "0");
+			pp.add_macro_definition("__VENDOR__", std::to_string(_vendor_id));
+			pp.add_macro_definition("__DEVICE__", std::to_string(_device_id));
+			pp.add_macro_definition("__RENDERER__", std::to_string(_renderer_id));
+			pp.add_macro_definition("__APPLICATION__", std::to_string( // Truncate hash to 32-bit, since lexer currently only supports 32-bit numbers anyway
+				std::hash<std::string>()(g_target_executable_path.stem().u8string()) & 0xFFFFFFFF));
+			pp.add_macro_definition("BUFFER_WIDTH", std::to_string(_width));
+			pp.add_macro_definition("BUFFER_HEIGHT", std::to_string(_height));
+			pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+			pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+			pp.add_macro_definition("BUFFER_COLOR_BIT_DEPTH", std::to_string(_color_bit_depth));
+
+			for (const std::string &definition : preprocessor_definitions)
+			{
+				if (definition.empty() || definition == "=")
+					continue; // Skip invalid definitions
+
+				const size_t equals_index = definition.find('=');
+				if (equals_index != std::string::npos)
+					pp.add_macro_definition(
+						definition.substr(0, equals_index),
+						definition.substr(equals_index + 1));
+				else
+					pp.add_macro_definition(definition);
+			}
 
+			for (const std::filesystem::path &include_path : include_paths)
+				pp.add_include_path(include_path);
+
+			// Add some conversion macros for compatibility with older versions of ReShade
+			pp.append_string(
+				"#define tex2Doffset(s, coords, offset) tex2D(s, coords, offset)\n"
+				"#define tex2Dlodoffset(s, coords, offset) tex2Dlod(s, coords, offset)\n"
+				"#define tex2Dgather(s, t, c) tex2Dgather##c(s, t)\n"
+				"#define tex2Dgatheroffset(s, t, o, c) tex2Dgather##c(s, t, o)\n"
+				"#define tex2Dgather0 tex2DgatherR\n"
+				"#define tex2Dgather1 tex2DgatherG\n"
+				"#define tex2Dgather2 tex2DgatherB\n"
+				"#define tex2Dgather3 tex2DgatherA\n");
+		};
+		const auto update_effect_dependencies = [&effect](const reshadefx::preprocessor &pp) {
 			// Keep track of used preprocessor definitions (so they can be displayed in the overlay)
 			effect.definitions.clear();
 			for (const auto &definition : pp.used_macro_definitions())
@@ -386,6 +380,64 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			// Keep track of included files
 			effect.included_files = pp.included_files();
 			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
+		};
+
+		// Scan the effect for its dependencies first, so that the cached pre-processed source can be validated without having to pre-process the effect again
+		// The cache then only has to be invalidated when a file the effect actually includes or a definition it actually uses changes
+		size_t cache_hash = 0;
+		if (!_no_effect_cache)
+		{
+			reshadefx::preprocessor pp;
+			initialize_preprocessor(pp);
+
+			if (pp.scan_file(source_file))
+			{
+				std::error_code ec;
+				std::string cache_attributes;
+				cache_attributes += "version=" + std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) + ';';
+				for (const std::filesystem::path &include_path : include_paths)
+					cache_attributes += include_path.u8string() + ';';
+				cache_attributes += source_file.u8string() + '?' + std::to_string(std::filesystem::last_write_time(source_file, ec).time_since_epoch().count()) + ';';
+				for (const std::filesystem::path &included_file : pp.included_files())
+					cache_attributes += included_file.u8string() + '?' + std::to_string(std::filesystem::last_write_time(included_file, ec).time_since_epoch().count()) + ';';
+
+				std::vector<std::pair<std::string, std::string>> macro_dependencies = pp.macro_dependencies();
+				std::sort(macro_dependencies.begin(), macro_dependencies.end());
+				for (const auto &definition : macro_dependencies)
+					cache_attributes += definition.first + '=' + definition.second + ';';
+
+				cache_hash = std::hash<std::string>()(cache_attributes);
+
+				if (!preprocess_required && load_effect_cache(source_file, cache_hash, source))
+				{
+					source_cached = true;
+					update_effect_dependencies(pp);
+				}
+			}
+		}
+
+		if (!source_cached)
+		{
+			reshadefx::preprocessor pp;
+			initialize_preprocessor(pp);
+
+			// Load and preprocess the source file
+			effect.preprocessed = pp.append_file(source_file);
+
+			// Append preprocessor errors to the error list
+			effect.errors      += pp.errors();
+
+			if (effect.preprocessed)
+			{
+				// The cached source is parsed on its own later, so needs the code locations embedded
+				if (cache_hash != 0)
+					source_cached = save_effect_cache(source_file, cache_hash, pp.output_with_line_directives());
+
+				source = std::move(pp.output());
+				source_map = pp.output_source_map();
+
+				update_effect_dependencies(pp);
+			}
 		}
 	}
 
@@ -414,7 +466,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		reshadefx::parser parser;
 
 		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
-		effect.compiled = parser.parse(std::move(source), codegen.get());
+		effect.compiled = parser.parse(std::move(source), source_map, codegen.get());
 
 		// Append parser errors to the error list
 		effect.errors  += parser.errors();
@@ -829,6 +881,9 @@ void reshade::runtime::unload_effects()
 
 	// Reset the effect list after all resources have been destroyed
 	_effects.clear();
+
+	// Drop cached include files and snapshots too, so they do not accumulate over the lifetime of the process (effects loaded afterwards simply fill the cache again)
+	s_include_cache.clear();
 }
 
 bool reshade::runtime::reload_effect(size_t effect_index, bool preprocess_required)
@@ -2060,7 +2115,7 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 	for (size_t i = 0, array_length = (variable.type.is_array() ? variable.type.array_length : 1);
 		i < array_length; ++i)
 	{
-		const reshadefx::constant &value = variable.type.is_array() ? variable.initializer_value.array_data[i] : variable.initializer_value;
+		const reshadefx::constant &value = variable.type.is_array() ? (*variable.initializer_value.array_data)[i] : variable.initializer_value;
 
 		switch (variable.type.base)
 		{
@@ -83,7 +83,7 @@ namespace reshade
 			const auto it = std::find_if(annotations.begin(), annotations.end(),
 				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
 			if (it == annotations.end()) return std::string_view();
-			return std::string_view(it->value.string_data);
+			return std::string_view(*it->value.string_data);
 		}
 
 		bool matches_description(const reshadefx::texture_info &desc) const
@@ -120,7 +120,7 @@ namespace reshade
 			const auto it = std::find_if(annotations.begin(), annotations.end(),
 				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
 			if (it == annotations.end()) return default_value;
-			return std::string_view(it->value.string_data);
+			return std::string_view(*it->value.string_data);
 		}
 
 		bool supports_toggle_key() const
@@ -161,7 +161,7 @@ namespace reshade
 			const auto it = std::find_if(annotations.begin(), annotations.end(),
 				[ann_name](const auto &annotation) { return annotation.name == ann_name; });
 			if (it == annotations.end()) return std::string_view();
-			return std::string_view(it->value.string_data);
+			return std::string_view(*it->value.string_data);
 		}
 
 		void *impl = nullptr;
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <string>
+
+namespace reshadefx
+{
+	namespace detail
+	{
+		inline void dump_value(std::string &out, const char *name, const std::string &value)
+		{
+			out += name;
+			out += '=';
+			out += value;
+			out += '\n';
+		}
+		inline void dump_value(std::string &out, const char *name, uint64_t value)
+		{
+			dump_value(out, name, std::to_string(value));
+		}
+
+		inline void dump_type(std::string &out, const char *name, const type &type)
+		{
+			dump_value(out, name,
+				std::to_string(type.base) + ' ' + std::to_string(type.rows) + 'x' + std::to_string(type.cols) + ' ' +
+				std::to_string(type.qualifiers) + ' ' + std::to_string(type.array_length) + ' ' + std::to_string(type.definition));
+		}
+
+		inline void dump_constant(std::string &out, const char *name, const type &type, const constant &value)
+		{
+			// Only compare the components that are used by the type, the others are undefined
+			std::string data;
+			for (unsigned int i = 0; i < type.components() && i < 16; ++i)
+				data += std::to_string(value.as_uint[i]) + ' ';
+			if (type.is_array())
+				for (const constant &element : *value.array_data)
+					for (unsigned int i = 0; i < type.components() && i < 16; ++i)
+						data += std::to_string(element.as_uint[i]) + ' ';
+			dump_value(out, name, data + '"' + *value.string_data + '"');
+		}
+
+		inline void dump_annotations(std::string &out, const std::vector<annotation> &annotations)
+		{
+			for (const annotation &annotation : annotations)
+			{
+				dump_value(out, "annotation", annotation.name);
+				dump_type(out, "annotation.type", annotation.type);
+				dump_constant(out, "annotation.value", annotation.type, annotation.value);
+			}
+		}
+
+		inline void dump_sampler(std::string &out, const sampler_info &info)
+		{
+			dump_value(out, "sampler", info.unique_name);
+			dump_value(out, "sampler.id", info.id);
+			dump_value(out, "sampler.binding", info.binding);
+			dump_value(out, "sampler.texture_binding", info.texture_binding);
+			dump_value(out, "sampler.texture_name", info.texture_name);
+			dump_annotations(out, info.annotations);
+			dump_value(out, "sampler.filter", static_cast<uint64_t>(info.filter));
+			dump_value(out, "sampler.address", std::to_string(static_cast<int>(info.address_u)) + ' ' + std::to_string(static_cast<int>(info.address_v)) + ' ' + std::to_string(static_cast<int>(info.address_w)));
+			dump_value(out, "sampler.lod", std::to_string(info.min_lod) + ' ' + std::to_string(info.max_lod) + ' ' + std::to_string(info.lod_bias));
+			dump_value(out, "sampler.srgb", info.srgb);
+		}
+		inline void dump_storage(std::string &out, const storage_info &info)
+		{
+			dump_value(out, "storage", info.unique_name);
+			dump_value(out, "storage.id", info.id);
+			dump_value(out, "storage.binding", info.binding);
+			dump_value(out, "storage.texture_name", info.texture_name);
+		}
+		inline void dump_uniform(std::string &out, const uniform_info &info)
+		{
+			dump_value(out, "uniform", info.name);
+			dump_type(out, "uniform.type", info.type);
+			dump_value(out, "uniform.size", info.size);
+			dump_value(out, "uniform.offset", info.offset);
+			dump_annotations(out, info.annotations);
+			dump_value(out, "uniform.has_initializer_value", info.has_initializer_value);
+			if (info.has_initializer_value)
+				dump_constant(out, "uniform.initializer_value", info.type, info.initializer_value);
+		}
+	}
+
+	/// <summary>
+	/// Convert the entire contents of the specified <paramref name="module"/> into a textual form, so that two modules can be compared and the first difference reported.
+	/// </summary>
+	inline std::string dump_module(const module &module)
+	{
+		using namespace detail;
+
+		std::string out;
+		dump_value(out, "hlsl", module.hlsl);
+		std::string spirv;
+		for (const uint32_t word : module.spirv)
+			spirv += std::to_string(word) + ' ';
+		dump_value(out, "spirv", spirv);
+
+		for (const entry_point &entry_point : module.entry_points)
+			dump_value(out, "entry_point", entry_point.name + ' ' + std::to_string(static_cast<int>(entry_point.type)));
+
+		for (const texture_info &info : module.textures)
+		{
+			dump_value(out, "texture", info.unique_name);
+			dump_value(out, "texture.id", info.id);
+			dump_value(out, "texture.binding", info.binding);
+			dump_value(out, "texture.semantic", info.semantic);
+			dump_annotations(out, info.annotations);
+			dump_value(out, "texture.size", std::to_string(info.width) + 'x' + std::to_string(info.height) + ' ' + std::to_string(info.levels));
+			dump_value(out, "texture.format", static_cast<uint64_t>(info.format));
+			dump_value(out, "texture.access", std::to_string(info.render_target) + ' ' + std::to_string(info.storage_access));
+		}
+		for (const sampler_info &info : module.samplers)
+			dump_sampler(out, info);
+		for (const storage_info &info : module.storages)
+			dump_storage(out, info);
+		for (const uniform_info &info : module.uniforms)
+			dump_uniform(out, info);
+		for (const uniform_info &info : module.spec_constants)
+			dump_uniform(out, info);
+
+		for (const technique_info &technique : module.techniques)
+		{
+			dump_value(out, "technique", technique.name);
+			dump_annotations(out, technique.annotations);
+
+			for (const pass_info &pass : technique.passes)
+			{
+				dump_value(out, "pass", pass.name);
+				for (const std::string &render_target_name : pass.render_target_names)
+					dump_value(out, "pass.render_target", render_target_name);
+				dump_value(out, "pass.entry_points", pass.vs_entry_point + ' ' + pass.ps_entry_point + ' ' + pass.cs_entry_point);
+				dump_value(out, "pass.flags",
+					std::to_string(pass.clear_render_targets) + ' ' + std::to_string(pass.srgb_write_enable) + ' ' + std::to_string(pass.blend_enable) + ' ' + std::to_string(pass.stencil_enable) + ' ' +
+					std::to_string(pass.color_write_mask) + ' ' + std::to_string(pass.stencil_read_mask) + ' ' + std::to_string(pass.stencil_write_mask));
+				dump_value(out, "pass.blend",
+					std::to_string(static_cast<int>(pass.blend_op)) + ' ' + std::to_string(static_cast<int>(pass.blend_op_alpha)) + ' ' +
+					std::to_string(static_cast<int>(pass.src_blend)) + ' ' + std::to_string(static_cast<int>(pass.dest_blend)) + ' ' +
+					std::to_string(static_cast<int>(pass.src_blend_alpha)) + ' ' + std::to_string(static_cast<int>(pass.dest_blend_alpha)));
+				dump_value(out, "pass.stencil",
+					std::to_string(static_cast<int>(pass.stencil_comparison_func)) + ' ' + std::to_string(pass.stencil_reference_value) + ' ' +
+					std::to_string(static_cast<int>(pass.stencil_op_pass)) + ' ' + std::to_string(static_cast<int>(pass.stencil_op_fail)) + ' ' + std::to_string(static_cast<int>(pass.stencil_op_depth_fail)));
+				dump_value(out, "pass.draw", std::to_string(pass.num_vertices) + ' ' + std::to_string(static_cast<int>(pass.topology)));
+				dump_value(out, "pass.viewport", std::to_string(pass.viewport_width) + 'x' + std::to_string(pass.viewport_height) + 'x' + std::to_string(pass.viewport_dispatch_z));
+				for (const sampler_info &info : pass.samplers)
+					dump_sampler(out, info);
+				for (const storage_info &info : pass.storages)
+					dump_storage(out, info);
+			}
+		}
+
+		dump_value(out, "total_uniform_size", module.total_uniform_size);
+		dump_value(out, "num_texture_bindings", module.num_texture_bindings);
+		dump_value(out, "num_sampler_bindings", module.num_sampler_bindings);
+		dump_value(out, "num_storage_bindings", module.num_storage_bindings);
+		return out;
+	}
+}
@@ -6,11 +6,16 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_batch.hpp"
+#include "effect_spirv_specializer.hpp"
+#include "effect_module_dump.hpp"
 #include "version.h"
 #include <cstdlib>
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 static void print_usage(const char *path)
 {
@@ -21,22 +26,33 @@ Options:
   --version                 Print ReShade version.
 
   -D <id>=<text>            Define a preprocessor macro.
+  --sweep <id>=<v1>,<v2>,.. Compile once for every value of a preprocessor macro. Can be specified multiple times to compile all combinations.
+                            Work is shared between permutations up to the point where they diverge. Output file names get the permutation index appended.
   -I <path>                 Add directory to include search path.
   -P <path>                 Pre-process to file. If <path> is "-", then result is written to standard output instead.
+  -M <path>                 Only scan for dependencies and write the include graph and definitions that affect the pre-processed result to file.
+                            If <path> is "-", then result is written to standard output instead.
 
   -Fo <file>                Output SPIR-V binary to the given file.
   -Fe <file>                Output warnings and errors to the given file.
 
   --glsl                    Print GLSL code for the previously specified entry point.
   --hlsl                    Print HLSL code for the previously specified entry point.
+                            These can be combined with each other and with '-Fo', in which case the effect is parsed only once and the result used for all outputs.
   --shader-model <value>    HLSL shader model version. Can be 30, 40, 41, 50, ...
 
   --width                   Value of the 'BUFFER_WIDTH' preprocessor macro.
   --height                  Value of the 'BUFFER_HEIGHT' preprocessor macro.
   --invert-y                Insert code to invert the Y component of the output position in vertex shaders (only applies to SPIR-V).
   --spec-constants          Convert uniform variables to specialization constants.
+  --specialize <id>=<v1>,.. Replace the specialization constants of a uniform variable with regular constants of the given values (one per component) in the SPIR-V.
+                            Can be specified multiple times. Implies '--spec-constants'. All other uniform variables with an initializer become constants of that value.
+                            Requires '-Fo' and cannot be combined with '--glsl' or '--hlsl'.
 
   -Zi                       Enable debug information.
+
+  --verify-threads <count>  Compile all input files (multiple are allowed in this mode) with every back-end as a batch on 1 through <count> threads
+                            and verify that the results are identical to those of the single-threaded run.
 	)", path);
 }
 
@@ -44,6 +60,7 @@ int main(int argc, char *argv[])
 {
 	const char *filename = nullptr;
 	const char *preprocess = nullptr;
+	const char *dependencies = nullptr;
 	const char *errorfile = nullptr;
 	const char *objectfile = nullptr;
 	const char *buffer_width = "800";
@@ -54,11 +71,15 @@ int main(int argc, char *argv[])
 	bool invert_y_axis = false;
 	bool spec_constants = false;
 	unsigned int shader_model = 50;
+	unsigned int verify_threads = 0;
+	std::vector<const char *> filenames;
+	std::vector<std::filesystem::path> include_paths;
+	std::vector<std::pair<std::string, std::string>> macros;
+	std::vector<std::pair<std::string, std::vector<std::string>>> sweeps;
+	std::vector<std::pair<std::string, std::vector<std::string>>> specializations;
 
-	reshadefx::parser parser;
-	reshadefx::preprocessor pp;
-	pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-	pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
+	macros.emplace_back("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+	macros.emplace_back("__RESHADE_PERFORMANCE_MODE__", "0");
 
 	// Parse command-line arguments
 	for (int i = 1; i < argc; ++i)
@@ -81,13 +102,13 @@ int main(int argc, char *argv[])
 				char *macro = argv[++i];
 				char *value = std::strchr(macro, '=');
 				if (value) *value++ = '\0';
-				pp.add_macro_definition(macro, value ? value : "1");
+				macros.emplace_back(macro, value ? value : "1");
 				continue;
 			}
 
 			if (0 == std::strcmp(arg, "-I"))
 			{
-				pp.add_include_path(argv[++i]);
+				include_paths.push_back(argv[++i]);
 				continue;
 			}
 
@@ -106,6 +127,8 @@ int main(int argc, char *argv[])
 				continue;
 			else if (0 == std::strcmp(arg, "-P"))
 				preprocess = argv[++i];
+			else if (0 == std::strcmp(arg, "-M"))
+				dependencies = argv[++i];
 			else if (0 == std::strcmp(arg, "-Fe"))
 				errorfile = argv[++i];
 			else if (0 == std::strcmp(arg, "-Fo"))
@@ -116,77 +139,350 @@ int main(int argc, char *argv[])
 				buffer_width = argv[++i];
 			else if (0 == std::strcmp(arg, "--height"))
 				buffer_height = argv[++i];
-		}
-		else
-		{
-			if (filename != nullptr)
+			else if (0 == std::strcmp(arg, "--verify-threads"))
 			{
-				std::cout << "error: More than one input file specified" << std::endl;
-				return 1;
+				char *end = nullptr;
+				const char *const count = argv[++i];
+				const unsigned long value = std::strtoul(count, &end, 10);
+				if (count[0] < '0' || count[0] > '9' || *end != '\0' || value == 0 || value > 1024)
+				{
+					std::cout << "error: Invalid thread count '" << count << "' (must be between 1 and 1024)" << std::endl;
+					return 1;
+				}
+
+				verify_threads = static_cast<unsigned int>(value);
 			}
+			else if (0 == std::strcmp(arg, "--sweep") || 0 == std::strcmp(arg, "--specialize"))
+			{
+				const bool is_sweep = 0 == std::strcmp(arg, "--sweep");
+
+				const std::string assignment = argv[++i];
+				const size_t equals_index = assignment.find('=');
+				if (equals_index == std::string::npos)
+				{
+					std::cout << "error: Invalid " << (is_sweep ? "sweep" : "specialization") << " '" << assignment << "'" << std::endl;
+					return 1;
+				}
+
+				std::vector<std::string> values;
+				for (size_t offset = equals_index + 1, next; offset <= assignment.size(); offset = next + 1)
+				{
+					if ((next = assignment.find(',', offset)) == std::string::npos)
+						next = assignment.size();
+					values.push_back(assignment.substr(offset, next - offset));
+				}
 
-			filename = arg;
+				(is_sweep ? sweeps : specializations).emplace_back(assignment.substr(0, equals_index), std::move(values));
+				if (!is_sweep)
+					spec_constants = true;
+			}
+		}
+		else
+		{
+			filenames.push_back(arg);
 		}
 	}
 
-	if (filename == nullptr)
+	if (filenames.empty())
 	{
 		print_usage(argv[0]);
 		return 1;
 	}
+	if (filenames.size() > 1 && verify_threads == 0)
+	{
+		std::cout << "error: More than one input file specified" << std::endl;
+		return 1;
+	}
+	if (!specializations.empty() && (print_glsl || print_hlsl))
+	{
+		std::cout << "error: '--specialize' only applies to SPIR-V output and cannot be combined with '--glsl' or '--hlsl'" << std::endl;
+		return 1;
+	}
+	if (!specializations.empty() && objectfile == nullptr)
+	{
+		std::cout << "error: '--specialize' requires an output file specified with '-Fo'" << std::endl;
+		return 1;
+	}
+
+	filename = filenames[0];
 
-	pp.add_macro_definition("BUFFER_WIDTH", buffer_width);
-	pp.add_macro_definition("BUFFER_HEIGHT", buffer_height);
-	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
-	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+	macros.emplace_back("BUFFER_WIDTH", buffer_width);
+	macros.emplace_back("BUFFER_HEIGHT", buffer_height);
+	macros.emplace_back("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+	macros.emplace_back("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
 
-	if (!pp.append_file(filename))
+	if (verify_threads != 0)
 	{
-		if (errorfile == nullptr)
-			std::cout << pp.errors() << std::endl;
-		else
-			std::ofstream(errorfile) << pp.errors();
-		return 1;
+		std::vector<reshadefx::compile_job> jobs;
+		for (const char *input : filenames)
+		{
+			for (const reshadefx::backend_type type : { reshadefx::backend_type::spirv, reshadefx::backend_type::hlsl, reshadefx::backend_type::glsl })
+			{
+				reshadefx::compile_job &job = jobs.emplace_back();
+				job.path = input;
+				job.include_paths = include_paths;
+				job.macros = macros;
+				job.backend.type = type;
+				job.backend.shader_model = shader_model;
+				job.backend.debug_info = debug_info;
+				job.backend.uniforms_to_spec_constants = spec_constants;
+				job.backend.flip_vert_y = invert_y_axis;
+			}
+		}
+
+		const std::vector<reshadefx::compile_result> reference = reshadefx::compile_batch(jobs, 1);
+
+		int result = 0;
+		for (unsigned int num_threads = 2; num_threads <= verify_threads; ++num_threads)
+		{
+			const std::vector<reshadefx::compile_result> results = reshadefx::compile_batch(jobs, num_threads);
+
+			for (size_t i = 0; i < jobs.size(); ++i)
+			{
+				// Compare the entire module, including uniforms, textures, samplers, techniques and specialization constants
+				if (results[i].success != reference[i].success ||
+					results[i].errors != reference[i].errors ||
+					reshadefx::dump_module(results[i].module) != reshadefx::dump_module(reference[i].module))
+				{
+					std::cout << "error: Result of job " << i << " ('" << jobs[i].path.u8string() << "') on " << num_threads << " threads differs from the single-threaded result" << std::endl;
+					result = 1;
+				}
+			}
+		}
+
+		if (result == 0)
+			std::cout << "Compiled " << jobs.size() << " jobs on 1 through " << verify_threads << " threads with identical results" << std::endl;
+		return result;
 	}
 
-	if (preprocess != nullptr)
+	reshadefx::preprocessor pp;
+	for (const std::filesystem::path &include_path : include_paths)
+		pp.add_include_path(include_path);
+	for (const auto &[name, value] : macros)
+		pp.add_macro_definition(name, value);
+
+	if (dependencies != nullptr)
 	{
-		if (std::strcmp(preprocess, "-") == 0)
-			std::cout << pp.output() << std::endl;
+		if (!pp.scan_file(filename))
+		{
+			if (errorfile == nullptr)
+				std::cout << pp.errors() << std::endl;
+			else
+				std::ofstream(errorfile) << pp.errors();
+			return 1;
+		}
+
+		std::string result;
+		for (const auto &[parent, child] : pp.include_graph())
+			result += parent.u8string() + ": " + child.u8string() + '\n';
+
+		std::vector<std::pair<std::string, std::string>> definitions = pp.macro_dependencies();
+		std::sort(definitions.begin(), definitions.end());
+		for (const auto &[name, value] : definitions)
+			result += "#define " + name + ' ' + value + '\n';
+
+		if (std::strcmp(dependencies, "-") == 0)
+			std::cout << result << std::flush;
 		else
-			std::ofstream(preprocess) << pp.output();
+			std::ofstream(dependencies) << result;
 		return 0;
 	}
 
-	std::unique_ptr<reshadefx::codegen> backend;
-	if (print_glsl)
-		backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants));
-	else if (print_hlsl)
-		backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
-	else
-		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, invert_y_axis));
+	const auto compile = [&](const reshadefx::preprocessor &pp, const std::string &suffix) {
+		if (preprocess != nullptr)
+		{
+			if (std::strcmp(preprocess, "-") == 0)
+				std::cout << pp.output_with_line_directives() << std::endl;
+			else
+				std::ofstream(preprocess + suffix) << pp.output_with_line_directives();
+			return 0;
+		}
+
+		std::unique_ptr<reshadefx::codegen> glsl_backend, hlsl_backend, spirv_backend;
+		if (print_glsl)
+			glsl_backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants));
+		if (print_hlsl)
+			hlsl_backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
+		if (objectfile != nullptr || (!print_glsl && !print_hlsl))
+			spirv_backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, false, invert_y_axis));
 
-	if (!parser.parse(pp.output(), backend.get()))
+		// Only parse once when multiple outputs are requested and replay the recorded code generation into every back-end
+		std::unique_ptr<reshadefx::codegen_recorder> recorder;
+		if ((glsl_backend != nullptr) + (hlsl_backend != nullptr) + (spirv_backend != nullptr) > 1)
+			recorder.reset(reshadefx::create_codegen_ir());
+
+		reshadefx::codegen *const parse_backend =
+			recorder != nullptr ? recorder.get() :
+			glsl_backend != nullptr ? glsl_backend.get() :
+			hlsl_backend != nullptr ? hlsl_backend.get() : spirv_backend.get();
+
+		reshadefx::parser parser;
+		if (!parser.parse(pp.output(), pp.output_source_map(), parse_backend))
+		{
+			if (errorfile == nullptr)
+				std::cout << pp.errors() << parser.errors() << std::endl;
+			else
+				std::ofstream(errorfile + suffix) << pp.errors() << parser.errors();
+			return 1;
+		}
+
+		if (recorder != nullptr)
+		{
+			std::vector<uint32_t> recording;
+			recorder->write_recording(recording);
+
+			for (reshadefx::codegen *backend : { glsl_backend.get(), hlsl_backend.get(), spirv_backend.get() })
+			{
+				if (backend != nullptr && !reshadefx::replay_codegen_ir(recording, backend))
+				{
+					std::cout << "error: Failed to replay code generation" << std::endl;
+					return 1;
+				}
+			}
+		}
+
+		for (reshadefx::codegen *backend : { glsl_backend.get(), hlsl_backend.get() })
+		{
+			if (backend == nullptr)
+				continue;
+
+			reshadefx::module module;
+			backend->write_result(module);
+
+			std::cout << module.hlsl << std::endl;
+		}
+
+		if (spirv_backend != nullptr && objectfile != nullptr)
+		{
+			reshadefx::module module;
+			spirv_backend->write_result(module);
+
+			if (!specializations.empty())
+			{
+				// Values are assigned to the specialization constants of a uniform variable in the order they were generated in, which is one per component
+				for (const auto &[name, values] : specializations)
+				{
+					size_t value_index = 0;
+					for (reshadefx::uniform_info &constant : module.spec_constants)
+					{
+						if (constant.name != name || value_index >= values.size())
+							continue;
+
+						const char *const value = values[value_index++].c_str();
+						char *end = nullptr;
+						// The code generator is created without 16-bit types, so minimum precision types are 32-bit in the module too
+						switch (constant.type.base)
+						{
+						case reshadefx::type::t_bool:
+							if (0 == std::strcmp(value, "true") || 0 == std::strcmp(value, "false"))
+							{
+								constant.initializer_value.as_uint[0] = value[0] == 't';
+								break;
+							}
+							constant.initializer_value.as_uint[0] = std::strtoul(value, &end, 10) != 0;
+							break;
+						case reshadefx::type::t_min16int:
+						case reshadefx::type::t_int:
+							constant.initializer_value.as_int[0] = std::strtol(value, &end, 10);
+							break;
+						case reshadefx::type::t_min16uint:
+						case reshadefx::type::t_uint:
+							constant.initializer_value.as_uint[0] = std::strtoul(value, &end, 10);
+							break;
+						case reshadefx::type::t_min16float:
+						case reshadefx::type::t_float:
+							constant.initializer_value.as_float[0] = std::strtof(value, &end);
+							break;
+						default:
+							std::cout << "error: Cannot specialize '" << name << "', because its type is not supported" << std::endl;
+							return 1;
+						}
+
+						if (end != nullptr && (end == value || *end != '\0'))
+						{
+							std::cout << "error: Invalid value '" << value << "' for specialization of '" << name << "'" << std::endl;
+							return 1;
+						}
+					}
+
+					if (value_index == 0)
+						std::cout << "warning: No specialization constant found for '" << name << "'" << std::endl;
+				}
+
+				if (!reshadefx::specialize_spirv(module))
+				{
+					std::cout << "error: Failed to specialize SPIR-V" << std::endl;
+					return 1;
+				}
+			}
+
+			std::ofstream(objectfile + suffix, std::ios::binary).write(
+				reinterpret_cast<const char *>(module.spirv.data()), module.spirv.size() * sizeof(uint32_t));
+		}
+
+		return 0;
+	};
+
+	if (sweeps.empty())
 	{
-		if (errorfile == nullptr)
-			std::cout << pp.errors() << parser.errors() << std::endl;
-		else
-			std::ofstream(errorfile) << pp.errors() << parser.errors();
-		return 1;
+		if (!pp.append_file(filename))
+		{
+			if (errorfile == nullptr)
+				std::cout << pp.errors() << std::endl;
+			else
+				std::ofstream(errorfile) << pp.errors();
+			return 1;
+		}
+
+		return compile(pp, std::string());
 	}
 
-	reshadefx::module module;
-	backend->write_result(module);
+	// Build list of all combinations of the swept macro values
+	std::vector<std::vector<std::pair<std::string, std::string>>> permutations(1);
+	for (const auto &[name, values] : sweeps)
+	{
+		std::vector<std::vector<std::pair<std::string, std::string>>> combined_permutations;
+		for (const auto &permutation : permutations)
+		{
+			for (const std::string &value : values)
+			{
+				combined_permutations.push_back(permutation);
+				combined_permutations.back().emplace_back(name, value);
+			}
+		}
+		permutations = std::move(combined_permutations);
+	}
 
-	if (print_glsl || print_hlsl)
+	std::vector<std::shared_ptr<reshadefx::preprocessor>> results;
+	pp.append_file_permutations(filename, permutations, results);
+	if (results.empty())
 	{
-		std::cout << module.hlsl << std::endl;
+		std::cout << "error: Could not open input file '" << filename << "'" << std::endl;
+		return 1;
 	}
-	else if (objectfile != nullptr)
+
+	int result = 0;
+	for (size_t i = 0; i < permutations.size(); ++i)
 	{
-		std::ofstream(objectfile, std::ios::binary).write(
-			reinterpret_cast<const char *>(module.spirv.data()), module.spirv.size() * sizeof(uint32_t));
+		std::cout << "// permutation " << i << ':';
+		for (const auto &[name, value] : permutations[i])
+			std::cout << ' ' << name << '=' << value;
+		std::cout << std::endl;
+
+		// Only skip the permutations that failed, the others can still be compiled
+		if (!results[i]->success())
+		{
+			if (errorfile == nullptr)
+				std::cout << results[i]->errors() << std::endl;
+			else
+				std::ofstream(errorfile + ('.' + std::to_string(i))) << results[i]->errors();
+			result = 1;
+			continue;
+		}
+
+		if (compile(*results[i], '.' + std::to_string(i)) != 0)
+			result = 1;
 	}
 
-	return 0;
+	return result;
 }
@@ -0,0 +1,660 @@
+/**
+ * Copyright (C) 2014 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_lexer.hpp"
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_preprocessor.hpp"
+#include "effect_module_dump.hpp"
+#include <new>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <functional>
+
+// Count all heap allocations, so that the benchmark can report them next to the time spent
+static std::atomic<size_t> s_num_allocations = 0;
+
+void *operator new(size_t size)
+{
+	++s_num_allocations;
+	if (void *const mem = std::malloc(size != 0 ? size : 1))
+		return mem;
+	throw std::bad_alloc();
+}
+void operator delete(void *mem) noexcept
+{
+	std::free(mem);
+}
+void operator delete(void *mem, size_t) noexcept
+{
+	std::free(mem);
+}
+
+static void print_usage(const char *path)
+{
+	printf(R"(usage: %s [options] <directory>
+
+Runs the regression tests for the effect compiler on the inputs in the specified directory (tools/tests in the repository).
+
+Options:
+  -h, --help                Print this help.
+  --bench <runs>            Instead of running the tests, measure time and heap allocations of every compile stage
+                            on the test inputs and a set of generated effects. Reports the best of <runs> runs.
+	)", path);
+}
+
+static unsigned int s_num_failed = 0;
+
+static void check(bool condition, const std::string &message)
+{
+	if (condition)
+		return;
+
+	std::cout << "  failed: " << message << std::endl;
+	s_num_failed++;
+}
+
+static std::string read_text_file(const std::filesystem::path &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void add_default_macros(reshadefx::preprocessor &pp)
+{
+	pp.add_macro_definition("__RESHADE__", "40000");
+	pp.add_macro_definition("BUFFER_WIDTH", "800");
+	pp.add_macro_definition("BUFFER_HEIGHT", "600");
+	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+}
+
+#pragma region Generated Inputs
+// These mirror the kind of effects the compiler spends most of its time on, scaled up so that timings are stable
+
+static std::string generate_comment_heavy_header(size_t target_size)
+{
+	std::string result;
+	for (size_t i = 0; result.size() < target_size; ++i)
+	{
+		result += "/**\n * Documentation for helper function number " + std::to_string(i) + ", which is long enough to span multiple vector widths.\n */\n";
+		result += "// Single line comment explaining the parameters of the function that follows it\n";
+		result += "float4 helper_function_with_a_long_name_" + std::to_string(i) + "(float4 color_value, float2 texture_coordinate)\n{\n";
+		result += "        return color_value * texture_coordinate.xyxy;                                  \n}\n\n";
+	}
+	return result;
+}
+
+static std::string generate_big_effect(unsigned int num_functions)
+{
+	std::string result;
+	result += "texture2D BackBufferTex : COLOR;\nsampler2D BackBuffer { Texture = BackBufferTex; };\n";
+	for (unsigned int i = 0; i < num_functions; ++i)
+	{
+		const std::string n = std::to_string(i);
+		result += "uniform float Strength" + n + " < ui_type = \"slider\"; ui_min = 0.0; ui_max = 1.0; ui_label = \"Strength " + n + "\"; > = 0.5;\n";
+		result += "texture2D Tex" + n + " { Width = BUFFER_WIDTH / 2; Height = BUFFER_HEIGHT / 2; Format = RGBA16F; };\n";
+		result += "sampler2D Samp" + n + " { Texture = Tex" + n + "; AddressU = CLAMP; MagFilter = LINEAR; };\n";
+		result += "float4 Blur" + n + "(float2 uv, float2 dir)\n{\n"
+			"\tfloat4 color = 0;\n"
+			"\t[unroll] for (int j = -4; j <= 4; ++j)\n"
+			"\t\tcolor += tex2Dlod(Samp" + n + ", float4(uv + dir * j * float2(BUFFER_RCP_WIDTH, BUFFER_RCP_HEIGHT), 0, 0)) * (1.0 / 9.0);\n"
+			"\tif (color.a > 0.5)\n\t\tcolor.rgb = lerp(color.rgb, color.rgb * color.rgb, Strength" + n + ");\n"
+			"\telse\n\t\tcolor.rgb = saturate(color.rgb + float3(0.1, 0.2, 0.3) * Strength" + n + ");\n"
+			"\treturn color;\n}\n";
+		result += "float4 PS" + n + "(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target { return Blur" + n + "(uv, float2(1, 0)) + tex2D(BackBuffer, uv); }\n";
+	}
+	result += "void VS(uint id : SV_VertexID, out float4 pos : SV_Position, out float2 uv : TEXCOORD)\n{\n"
+		"\tuv.x = (id == 2) ? 2.0 : 0.0;\n\tuv.y = (id == 1) ? 2.0 : 0.0;\n\tpos = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n}\n";
+	result += "technique Big\n{\n";
+	for (unsigned int i = 0; i < num_functions; ++i)
+		result += "\tpass { VertexShader = VS; PixelShader = PS" + std::to_string(i) + "; RenderTarget = Tex" + std::to_string(i) + "; }\n";
+	result += "}\n";
+	return result;
+}
+
+static std::string generate_macro_heavy_effect(unsigned int num_declarations)
+{
+	std::string result;
+	result +=
+		"#define UI_FLOAT(name, label, minval, maxval, defval) uniform float name < ui_type = \"slider\"; ui_label = label; ui_min = minval; ui_max = maxval; > = defval;\n"
+		"#define UI_BOOL(name, label, defval) uniform bool name < ui_label = label; > = defval;\n"
+		"#define CAT(a, b) a##b\n"
+		"#define SAMPLE(s, uv, x, y) tex2Doffset(s, uv, int2(x, y))\n"
+		"#define UNROLL2(m, s, uv, y) m(s, uv, -1, y) + m(s, uv, 1, y)\n"
+		"#define UNROLL4(m, s, uv) UNROLL2(m, s, uv, -1) + UNROLL2(m, s, uv, 1)\n"
+		"#define UNROLL16(m, s, uv) (UNROLL4(m, s, uv) + UNROLL4(m, s, uv) + UNROLL4(m, s, uv) + UNROLL4(m, s, uv))\n"
+		"#define tex2Doffset(s, coords, offset) tex2D(s, coords, offset)\n"
+		"texture2D BackBufferTex : COLOR;\nsampler2D BackBuffer { Texture = BackBufferTex; };\n";
+	for (unsigned int i = 0; i < num_declarations; ++i)
+	{
+		const std::string n = std::to_string(i);
+		result += "UI_FLOAT(CAT(Amount, " + n + "), \"Amount " + n + "\", 0.0, 1.0, 0.5)\n";
+		result += "UI_BOOL(CAT(Enable, " + n + "), \"Enable " + n + "\", true)\n";
+		result += "float4 CAT(Filter, " + n + ")(float2 uv) { return CAT(Enable, " + n + ") ? UNROLL16(SAMPLE, BackBuffer, uv) * CAT(Amount, " + n + ") / 16.0 : tex2D(BackBuffer, uv); }\n";
+	}
+	result += "float4 PS(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target\n{\n\tfloat4 color = 0;\n";
+	for (unsigned int i = 0; i < num_declarations; ++i)
+		result += "\tcolor += CAT(Filter, " + std::to_string(i) + ")(uv);\n";
+	result += "\treturn color;\n}\n";
+	result += "void VS(uint id : SV_VertexID, out float4 pos : SV_Position, out float2 uv : TEXCOORD)\n{\n"
+		"\tuv.x = (id == 2) ? 2.0 : 0.0;\n\tuv.y = (id == 1) ? 2.0 : 0.0;\n\tpos = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n}\n";
+	result += "technique MacroHeavy { pass { VertexShader = VS; PixelShader = PS; } }\n";
+	return result;
+}
+
+static std::string generate_literal_effect(unsigned int num_statements)
+{
+	std::string result;
+	result += "float4 PS(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target\n{\n\tfloat4 color = 0;\n";
+	for (unsigned int i = 0; i < num_statements; ++i)
+		result += "\tcolor += float4(" + std::to_string(i) + ".25, " + std::to_string(i) + ".5, " + std::to_string(i) + ".75, 1.0) * uv.x;\n";
+	result += "\treturn color;\n}\n";
+	result += "void VS(uint id : SV_VertexID, out float4 pos : SV_Position, out float2 uv : TEXCOORD)\n{\n"
+		"\tuv.x = (id == 2) ? 2.0 : 0.0;\n\tuv.y = (id == 1) ? 2.0 : 0.0;\n\tpos = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n}\n";
+	result += "technique Literals { pass { VertexShader = VS; PixelShader = PS; } }\n";
+	return result;
+}
+
+static std::string generate_constant_table_effect(unsigned int num_entries, unsigned int num_lookups)
+{
+	std::string result;
+	result += "static const float4 FloatTable[" + std::to_string(num_entries) + "] = {\n";
+	for (unsigned int i = 0; i < num_entries; ++i)
+		result += "\tfloat4(" + std::to_string(i) + ".0, " + std::to_string(i) + ".5, 0.25, 1.0),\n";
+	result += "};\nstatic const int IntTable[" + std::to_string(num_entries) + "] = {\n";
+	for (unsigned int i = 0; i < num_entries; ++i)
+		result += "\t" + std::to_string(i * 7 % num_entries) + ",\n";
+	result += "};\n";
+	result += "float4 PS(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target\n{\n\tfloat4 color = 0;\n";
+	for (unsigned int i = 0; i < num_lookups; ++i)
+		result += "\tcolor += FloatTable[IntTable[" + std::to_string(i % num_entries) + "]] * uv.x;\n";
+	result += "\treturn color;\n}\n";
+	result += "void VS(uint id : SV_VertexID, out float4 pos : SV_Position, out float2 uv : TEXCOORD)\n{\n"
+		"\tuv.x = (id == 2) ? 2.0 : 0.0;\n\tuv.y = (id == 1) ? 2.0 : 0.0;\n\tpos = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n}\n";
+	result += "technique Constants { pass { VertexShader = VS; PixelShader = PS; } }\n";
+	return result;
+}
+
+#pragma endregion
+
+struct preprocess_result
+{
+	bool success = false;
+	std::string output;
+	std::string errors;
+};
+
+static preprocess_result preprocess(const std::filesystem::path &path, const std::vector<std::pair<std::string, std::string>> &macros = {}, reshadefx::include_cache *cache = nullptr)
+{
+	reshadefx::preprocessor pp;
+	pp.set_include_cache(cache);
+	pp.add_include_path(path.parent_path());
+	add_default_macros(pp);
+	for (const auto &[name, value] : macros)
+		pp.add_macro_definition(name, value);
+
+	preprocess_result result;
+	result.success = pp.append_file(path);
+	result.output = pp.output_with_line_directives();
+	result.errors = pp.errors();
+	return result;
+}
+
+static std::vector<std::filesystem::path> find_effect_files(const std::filesystem::path &directory)
+{
+	std::vector<std::filesystem::path> files;
+	std::error_code ec;
+	for (const auto &entry : std::filesystem::directory_iterator(directory, ec))
+		if (entry.path().extension() == ".fx")
+			files.push_back(entry.path());
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+#pragma region Tests
+
+static void test_lexer_runs(const std::filesystem::path &)
+{
+	// Runs of white space, identifier characters and comments of every length up to a few vector widths, so that all combinations of the vectorized and scalar paths are hit
+	for (size_t space_length = 0; space_length < 40; ++space_length)
+	{
+		for (size_t identifier_length = 1; identifier_length < 40; ++identifier_length)
+		{
+			for (size_t comment_length = 0; comment_length < 40; comment_length += 3)
+			{
+				const std::string identifier = 'a' + std::string(identifier_length - 1, '_');
+				const std::string input = std::string(space_length, space_length % 2 ? '\t' : ' ') + identifier + "/*" + std::string(comment_length, '*') + "*/+// " + std::string(comment_length, 'x') + '\n';
+
+				reshadefx::lexer lexer(input);
+				const reshadefx::token identifier_token = lexer.lex();
+				const reshadefx::token plus_token = lexer.lex();
+				const reshadefx::token end_token = lexer.lex();
+
+				const std::string description = "white space " + std::to_string(space_length) + ", identifier " + std::to_string(identifier_length) + ", comment " + std::to_string(comment_length);
+				check(identifier_token.id == reshadefx::tokenid::identifier && identifier_token.offset == space_length && identifier_token.length == identifier_length && identifier_token.literal_as_string == identifier,
+					"lexer identifier (" + description + ')');
+				check(identifier_token.location.column == space_length + 1, "lexer column (" + description + ')');
+				check(plus_token.id == reshadefx::tokenid::plus && plus_token.offset == space_length + identifier_length + comment_length + 4,
+					"lexer token after comment (" + description + ')');
+				check(end_token.id == reshadefx::tokenid::end_of_file, "lexer end of input (" + description + ')');
+			}
+		}
+	}
+}
+
+static void test_include_snapshots(const std::filesystem::path &directory)
+{
+	// Preprocessing with a shared include cache, which reuses snapshots of include files across preprocessor instances, has to produce the exact same result as without
+	reshadefx::include_cache cache;
+
+	for (const std::vector<std::pair<std::string, std::string>> &macros : {
+			std::vector<std::pair<std::string, std::string>> {},
+			std::vector<std::pair<std::string, std::string>> { { "SNAPSHOT_QUALITY", "3" } },
+			std::vector<std::pair<std::string, std::string>> {} })
+	{
+		for (const std::filesystem::path &path : find_effect_files(directory))
+		{
+			const preprocess_result expected = preprocess(path, macros);
+
+			for (int run = 0; run < 2; ++run)
+			{
+				const preprocess_result actual = preprocess(path, macros, &cache);
+				check(actual.success == expected.success && actual.errors == expected.errors, "include snapshot errors (" + path.filename().u8string() + ')');
+				check(actual.output == expected.output, "include snapshot output (" + path.filename().u8string() + ')');
+			}
+		}
+	}
+}
+
+static void test_include_guards(const std::filesystem::path &directory)
+{
+	// Files with an include guard are skipped when included again, which must not change the output
+	const preprocess_result result = preprocess(directory / "guards.fx");
+	check(result.success && result.errors.empty(), "include guards errors: " + result.errors);
+
+	const auto count = [&output = result.output](const std::string &name) {
+		size_t num = 0;
+		for (size_t offset = 0; (offset = output.find(name + " = ", offset)) != std::string::npos; ++offset)
+			++num;
+		return num;
+	};
+
+	check(count("GuardIfndef") == 1, "include guard with #ifndef");
+	check(count("GuardIfDefined") == 2, "include guard with #if !defined(X)");
+	check(count("GuardIfDefinedSpace") == 1, "include guard with #if ! defined X");
+	check(count("GuardNotAGuard") == 2, "condition that is not an include guard");
+	check(count("GuardElseFirst") == 1 && count("GuardElseAgain") == 1, "include guard with #else");
+
+	// Every time a file is processed it gets a #line directive, so this shows whether it was skipped without lexing it again
+	const auto count_processed = [&output = result.output](const std::string &file_name) {
+		size_t num = 0;
+		for (size_t offset = 0; (offset = output.find(file_name + "\"\n", offset)) != std::string::npos; ++offset)
+			++num;
+		return num;
+	};
+
+	check(count_processed("guard_ifndef.fxh") == 1, "include guard skip with #ifndef");
+	check(count_processed("guard_if_defined.fxh") == 2, "include guard skip with #if !defined(X)");
+	check(count_processed("guard_if_defined_space.fxh") == 1, "include guard skip with #if ! defined X");
+	check(count_processed("guard_not_a_guard.fxh") == 2 && count_processed("guard_else.fxh") == 2, "include guard skip of files without guard");
+}
+
+static void test_scan(const std::filesystem::path &directory)
+{
+	const std::vector<std::pair<std::string, std::string>> external_macros = {
+		{ "SCAN_QUALITY", "2" }, { "SCAN_FEATURE", "1" }, { "SCAN_SKIPPED", "3" }, { "SCAN_VALUE", "4" }, { "SCAN_INDIRECT", "5" }, { "SCAN_UNUSED", "6" }, { "SCAN_HEADER_SCALE", "7" } };
+
+	const auto preprocess_without = [&](const std::filesystem::path &path, const std::string &excluded_name) {
+		reshadefx::preprocessor pp;
+		pp.add_include_path(directory);
+		for (const auto &[name, value] : external_macros)
+			if (name != excluded_name)
+				pp.add_macro_definition(name, value);
+		pp.append_file(path);
+		return pp.output();
+	};
+
+	for (const auto &[file_name, expected_dependencies] : {
+			std::make_pair("scan.fx", std::vector<std::string> { "SCAN_FEATURE", "SCAN_HEADER_SCALE", "SCAN_INDIRECT", "SCAN_QUALITY", "SCAN_VALUE" }),
+			std::make_pair("scan_concat.fx", std::vector<std::string> { "SCAN_FEATURE", "SCAN_HEADER_SCALE", "SCAN_INDIRECT", "SCAN_QUALITY", "SCAN_SKIPPED", "SCAN_UNUSED", "SCAN_VALUE" }) })
+	{
+		const std::filesystem::path path = directory / file_name;
+
+		reshadefx::preprocessor pp;
+		pp.add_include_path(directory);
+		for (const auto &[name, value] : external_macros)
+			pp.add_macro_definition(name, value);
+		check(pp.scan_file(path), std::string("scan errors (") + file_name + "): " + pp.errors());
+
+		std::vector<std::string> dependencies;
+		for (const auto &[name, value] : pp.macro_dependencies())
+			dependencies.push_back(name);
+		std::sort(dependencies.begin(), dependencies.end());
+		check(dependencies == expected_dependencies, std::string("scan dependencies (") + file_name + ')');
+
+		// Removing a macro that is not a dependency must not change the output
+		const std::string expected_output = preprocess_without(path, std::string());
+		for (const auto &[name, value] : external_macros)
+			if (std::find(dependencies.begin(), dependencies.end(), name) == dependencies.end())
+				check(preprocess_without(path, name) == expected_output, std::string("scan missed dependency ") + name + " (" + file_name + ')');
+	}
+
+	reshadefx::preprocessor pp;
+	pp.add_include_path(directory);
+	pp.scan_file(directory / "scan.fx");
+	const auto include_graph = pp.include_graph();
+	check(include_graph.size() == 1 && include_graph[0].first.filename() == "scan.fx" && include_graph[0].second.filename() == "scan.fxh", "scan include graph");
+}
+
+static void test_permutations(const std::filesystem::path &directory)
+{
+	// Processing all permutations together, which shares work up to the point where they diverge, has to give the same result as processing each of them on its own
+	std::vector<std::vector<std::pair<std::string, std::string>>> permutations;
+	for (const char *quality : { "1", "2" })
+		for (const char *q : { "0", "1" })
+		{
+			permutations.push_back({ { "PERM_QUALITY", quality }, { "Q", q } });
+			permutations.push_back({ { "PERM_QUALITY", quality }, { "Q", q }, { "PERM_FEATURE", "3" } });
+		}
+
+	for (const std::filesystem::path &path : find_effect_files(directory))
+	{
+		reshadefx::preprocessor pp;
+		pp.add_include_path(directory);
+		add_default_macros(pp);
+
+		std::vector<std::shared_ptr<reshadefx::preprocessor>> results;
+		const bool success = pp.append_file_permutations(path, permutations, results);
+
+		bool expected_success = true;
+		for (size_t i = 0; i < permutations.size(); ++i)
+		{
+			const preprocess_result expected = preprocess(path, permutations[i]);
+			expected_success &= expected.success;
+
+			const std::string description = " (" + path.filename().u8string() + ", permutation " + std::to_string(i) + ')';
+			check(results[i]->success() == expected.success && results[i]->errors() == expected.errors, "permutation errors" + description);
+			check(results[i]->output_with_line_directives() == expected.output, "permutation output" + description);
+		}
+
+		check(success == expected_success, "permutations success (" + path.filename().u8string() + ')');
+	}
+}
+
+static void test_source_map(const std::filesystem::path &directory)
+{
+	// Parsing the output together with its source map has to give the same code locations as parsing the output with embedded #line directives
+	for (const std::filesystem::path &path : find_effect_files(directory))
+	{
+		reshadefx::preprocessor pp;
+		pp.add_include_path(directory);
+		add_default_macros(pp);
+		pp.append_file(path);
+
+		std::string errors[2], code[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			const std::unique_ptr<reshadefx::codegen> backend(reshadefx::create_codegen_hlsl(50, true, false));
+			reshadefx::parser parser;
+			if (i == 0)
+				parser.parse(pp.output(), pp.output_source_map(), backend.get());
+			else
+				parser.parse(pp.output_with_line_directives(), reshadefx::source_map(), backend.get());
+
+			reshadefx::module module;
+			backend->write_result(module);
+			errors[i] = parser.errors();
+			code[i] = module.hlsl;
+		}
+
+		check(errors[0] == errors[1], "source map errors (" + path.filename().u8string() + ')');
+		check(code[0] == code[1], "source map code locations (" + path.filename().u8string() + ')');
+	}
+}
+
+static void test_file_mappings(const std::filesystem::path &)
+{
+	// Large files are mapped into memory, which must not be accessed anymore after the call that read them returned, since the file may be truncated or rewritten in the meantime
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "fxtest_mappings";
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+
+	std::string header;
+	for (int i = 0; header.size() < 64 * 1024; ++i)
+		header += "static const float MappedValue" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+
+	std::ofstream(directory / "mapped.fxh", std::ios::binary) << header;
+	std::ofstream(directory / "mapped.fx", std::ios::binary) << "#include \"mapped.fxh\"\n";
+
+	reshadefx::preprocessor pp;
+	pp.add_include_path(directory);
+	check(pp.append_file(directory / "mapped.fx"), "file mapping first include");
+
+	const size_t first_output_size = pp.output().size();
+
+	// Truncate the file, which would cause an access violation if its mapping was still used
+	std::ofstream(directory / "mapped.fxh", std::ios::binary | std::ios::trunc) << "\n";
+
+	check(pp.append_string("#include \"mapped.fxh\"\n"), "file mapping second include");
+	check(pp.output().size() >= 2 * first_output_size, "file mapping cached contents");
+
+	std::filesystem::remove_all(directory, ec);
+}
+
+static void test_record_replay(const std::filesystem::path &directory)
+{
+	// Replaying a recording of the code generation calls into a back-end has to produce the exact same module as parsing into that back-end directly
+	const std::pair<const char *, std::function<reshadefx::codegen *()>> backends[] = {
+		{ "hlsl 30", []() { return reshadefx::create_codegen_hlsl(30, false, false); } },
+		{ "hlsl 50", []() { return reshadefx::create_codegen_hlsl(50, false, false); } },
+		{ "hlsl 50 debug spec", []() { return reshadefx::create_codegen_hlsl(50, true, true); } },
+		{ "glsl", []() { return reshadefx::create_codegen_glsl(false, false); } },
+		{ "glsl debug spec 16-bit flip", []() { return reshadefx::create_codegen_glsl(true, true, true, true); } },
+		{ "spirv", []() { return reshadefx::create_codegen_spirv(true, false, false); } },
+		{ "spirv debug spec 16-bit flip", []() { return reshadefx::create_codegen_spirv(true, true, true, true, true); } },
+	};
+
+	for (const std::filesystem::path &path : find_effect_files(directory))
+	{
+		reshadefx::preprocessor pp;
+		pp.add_include_path(directory);
+		add_default_macros(pp);
+		if (!pp.append_file(path))
+			continue;
+
+		const std::unique_ptr<reshadefx::codegen_recorder> recorder(reshadefx::create_codegen_ir());
+		reshadefx::parser recording_parser;
+		const bool recorded = recording_parser.parse(pp.output(), pp.output_source_map(), recorder.get());
+		std::vector<uint32_t> recording;
+		if (recorded)
+			recorder->write_recording(recording);
+
+		for (const auto &[backend_name, create_backend] : backends)
+		{
+			const std::string description = path.filename().u8string() + ", " + backend_name;
+
+			const std::unique_ptr<reshadefx::codegen> direct_backend(create_backend());
+			if (direct_backend == nullptr)
+				continue; // Back-end is not available in this build
+
+			reshadefx::parser parser;
+			const bool parsed = parser.parse(pp.output(), pp.output_source_map(), direct_backend.get());
+			check(parsed == recorded && parser.errors() == recording_parser.errors(), "record and replay parse result (" + description + ')');
+			if (!parsed || !recorded)
+				continue;
+
+			const std::unique_ptr<reshadefx::codegen> replay_backend(create_backend());
+			check(reshadefx::replay_codegen_ir(recording, replay_backend.get()), "record and replay success (" + description + ')');
+
+			reshadefx::module direct_module, replay_module;
+			direct_backend->write_result(direct_module);
+			replay_backend->write_result(replay_module);
+			check(reshadefx::dump_module(direct_module) == reshadefx::dump_module(replay_module), "record and replay module (" + description + ')');
+		}
+	}
+}
+
+#pragma endregion
+
+#pragma region Benchmark
+
+struct bench_result
+{
+	double milliseconds = 0;
+	size_t allocations = 0;
+};
+
+static bench_result measure(unsigned int num_runs, const std::function<void()> &work)
+{
+	bench_result best;
+	for (unsigned int run = 0; run < num_runs; ++run)
+	{
+		const size_t allocations_before = s_num_allocations;
+		const auto time_before = std::chrono::high_resolution_clock::now();
+
+		work();
+
+		const auto time_after = std::chrono::high_resolution_clock::now();
+		const double milliseconds = std::chrono::duration<double, std::milli>(time_after - time_before).count();
+
+		if (run == 0 || milliseconds < best.milliseconds)
+			best.milliseconds = milliseconds;
+		best.allocations = s_num_allocations - allocations_before; // This is the same for every run
+	}
+	return best;
+}
+
+static void print_bench_result(const std::string &input_name, const char *stage_name, const bench_result &result)
+{
+	printf("%-20s %-24s %10.2f ms %12zu allocations\n", input_name.c_str(), stage_name, result.milliseconds, result.allocations);
+}
+
+static void bench_input(const std::string &name, const std::string &source, unsigned int num_runs, const std::filesystem::path &path = std::filesystem::path())
+{
+	printf("%-20s %-24s %10zu bytes\n", name.c_str(), "size", source.size());
+
+	print_bench_result(name, "lex", measure(num_runs, [&source]() {
+		reshadefx::lexer lexer(source, true, true, true);
+		while (lexer.lex().id != reshadefx::tokenid::end_of_file)
+			continue;
+	}));
+
+	std::string preprocessed;
+	reshadefx::source_map source_map;
+	print_bench_result(name, "preprocess", measure(num_runs, [&]() {
+		reshadefx::preprocessor pp;
+		add_default_macros(pp);
+		if (path.empty())
+			pp.append_string(source);
+		else
+		{
+			pp.add_include_path(path.parent_path());
+			pp.append_file(path);
+		}
+		preprocessed = pp.output();
+		source_map = pp.output_source_map();
+	}));
+
+	const auto bench_backend = [&](const char *stage_name, const std::function<reshadefx::codegen *()> &create_backend) {
+		if (const std::unique_ptr<reshadefx::codegen> backend(create_backend()); backend == nullptr)
+			return; // Back-end is not available in this build
+
+		print_bench_result(name, stage_name, measure(num_runs, [&]() {
+			const std::unique_ptr<reshadefx::codegen> backend(create_backend());
+			reshadefx::parser parser;
+			parser.parse(preprocessed, source_map, backend.get());
+			reshadefx::module module;
+			backend->write_result(module);
+		}));
+	};
+
+	bench_backend("parse + hlsl", []() { return reshadefx::create_codegen_hlsl(50, false, false); });
+	bench_backend("parse + glsl", []() { return reshadefx::create_codegen_glsl(false, false); });
+	bench_backend("parse + spirv", []() { return reshadefx::create_codegen_spirv(true, false, false); });
+}
+
+#pragma endregion
+
+int main(int argc, char *argv[])
+{
+	const char *directory = nullptr;
+	unsigned int bench_runs = 0;
+
+	// Parse command-line arguments
+	for (int i = 1; i < argc; ++i)
+	{
+		if (const char *arg = argv[i]; arg[0] == '-')
+		{
+			if (0 == std::strcmp(arg, "-h") || 0 == std::strcmp(arg, "--help"))
+			{
+				print_usage(argv[0]);
+				return 0;
+			}
+
+			if (i + 1 >= argc)
+				continue;
+			else if (0 == std::strcmp(arg, "--bench"))
+				bench_runs = std::strtoul(argv[++i], nullptr, 10);
+		}
+		else
+		{
+			directory = arg;
+		}
+	}
+
+	if (directory == nullptr)
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	const std::filesystem::path test_directory = std::filesystem::u8path(directory);
+
+	if (bench_runs != 0)
+	{
+		bench_input("comment_header", generate_comment_heavy_header(4 * 1024 * 1024), bench_runs);
+		bench_input("big", generate_big_effect(200), bench_runs);
+		bench_input("macro_heavy", generate_macro_heavy_effect(100), bench_runs);
+		bench_input("literals", generate_literal_effect(5000), bench_runs);
+		bench_input("constants", generate_constant_table_effect(4000, 3000), bench_runs);
+
+		for (const std::filesystem::path &path : find_effect_files(test_directory))
+			bench_input(path.filename().u8string(), read_text_file(path), bench_runs, path);
+		return 0;
+	}
+
+	const std::pair<const char *, void(*)(const std::filesystem::path &)> tests[] = {
+		{ "lexer runs", test_lexer_runs },
+		{ "include snapshots", test_include_snapshots },
+		{ "include guards", test_include_guards },
+		{ "scan", test_scan },
+		{ "permutations", test_permutations },
+		{ "source map", test_source_map },
+		{ "file mappings", test_file_mappings },
+		{ "record and replay", test_record_replay },
+	};
+
+	for (const auto &[name, test] : tests)
+	{
+		std::cout << name << std::endl;
+		test(test_directory);
+	}
+
+	if (s_num_failed != 0)
+	{
+		std::cout << s_num_failed << " checks failed" << std::endl;
+		return 1;
+	}
+
+	std::cout << "All tests passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,21 @@
+#include "ReShade.fxh"
+
+uniform float Strength < ui_type = "slider"; ui_min = 0.0; ui_max = 1.0; > = 0.5;
+
+texture2D BackBufferTex : COLOR;
+sampler2D BackBuffer { Texture = BackBufferTex; };
+
+float4 PS_Basic(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	float4 color = tex2D(BackBuffer, uv);
+	return lerp(color, color * color, Strength);
+}
+
+technique Basic
+{
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = PS_Basic;
+	}
+}
@@ -0,0 +1,18 @@
+// Includes files with different kinds of include guards several times, so that the include guard skip is used
+
+#include "guard_ifndef.fxh"
+#include "guard_if_defined.fxh"
+#include "guard_if_defined_space.fxh"
+#include "guard_not_a_guard.fxh"
+#include "guard_else.fxh"
+
+#include "guard_ifndef.fxh"
+#include "guard_if_defined.fxh"
+#include "guard_if_defined_space.fxh"
+#include "guard_else.fxh"
+
+#define GUARD_INCLUDE_AGAIN 1
+#include "guard_not_a_guard.fxh"
+
+#undef GUARD_IF_DEFINED_FXH
+#include "guard_if_defined.fxh"
@@ -0,0 +1,40 @@
+// Processed once for every permutation of 'PERM_QUALITY', 'PERM_FEATURE' and 'Q', which has to give the same result as processing each permutation on its own
+
+#include "ReShade.fxh"
+
+#define PERM_CAT(a, b) a##b
+#define PERM_V_A Q
+
+// The macro name is formed by token concatenation on a directive line, so which macro it depends on is only known after expanding it
+#if PERM_CAT(PERM_V_, A)
+static const int PermOne = 1;
+#else
+static const int PermZero = 0;
+#endif
+
+#ifdef PERM_FEATURE
+static const int PermFeature = PERM_FEATURE;
+#endif
+
+#if PERM_QUALITY > 1
+	#define PERM_SAMPLES 8
+#else
+	#define PERM_SAMPLES 4
+#endif
+
+static const int PermSamples = PERM_SAMPLES;
+static const int PermConcat = PERM_CAT(PERM_, SAMPLES) + PERM_CAT(PERM_V_, A);
+
+float4 PS_Permutations(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	return PERM_SAMPLES * PERM_QUALITY;
+}
+
+technique Permutations
+{
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = PS_Permutations;
+	}
+}
@@ -0,0 +1,167 @@
+#include "ReShade.fxh"
+
+// Covers as many different code generation calls as possible, so that replaying a recording can be compared against generating code directly
+
+uniform float Strength < ui_type = "slider"; ui_min = 0.0; ui_max = 1.0; > = 0.5;
+uniform float3 Tint < ui_type = "color"; > = float3(1.0, 0.9, 0.8);
+uniform int Mode < ui_type = "combo"; ui_items = "Off\0Low\0High\0"; > = 1;
+uniform uint Steps = 4;
+uniform bool Enabled = true;
+uniform bool2 Flags = bool2(true, false);
+uniform float2x2 Rotation = float2x2(0.8, -0.6, 0.6, 0.8);
+uniform float4 Weights[3] = { float4(1, 2, 3, 4), float4(5, 6, 7, 8), float4(9, 10, 11, 12) };
+uniform float Timer < source = "timer"; >;
+
+texture2D BackBufferTex : COLOR;
+texture2D DepthTex : DEPTH;
+texture2D IntermediateTex { Width = BUFFER_WIDTH / 2; Height = BUFFER_HEIGHT / 2; Format = RGBA16F; MipLevels = 2; };
+texture2D LumaTex { Width = 1; Height = 1; Format = R32F; };
+
+sampler2D BackBuffer { Texture = BackBufferTex; SRGBTexture = true; };
+sampler2D Depth { Texture = DepthTex; MinFilter = POINT; MagFilter = POINT; MipFilter = POINT; };
+sampler2D Intermediate { Texture = IntermediateTex; AddressU = MIRROR; AddressV = BORDER; MipLODBias = 0.5; };
+sampler2D Luma { Texture = LumaTex; };
+
+static const float Kernel[5] = { 0.06, 0.24, 0.4, 0.24, 0.06 };
+static const int2 Offsets[2] = { int2(1, 0), int2(0, 1) };
+
+struct Surface
+{
+	float3 color;
+	float depth;
+	bool is_sky;
+};
+
+namespace Helpers
+{
+	float luminance(float3 color)
+	{
+		return dot(color, float3(0.2126, 0.7152, 0.0722));
+	}
+}
+
+Surface sample_surface(float2 uv)
+{
+	Surface s;
+	s.color = tex2D(BackBuffer, uv).rgb;
+	s.depth = tex2Dlod(Depth, float4(uv, 0, 0)).x;
+	s.is_sky = s.depth >= 0.999;
+	return s;
+}
+
+void split(float value, out float whole, inout float sum)
+{
+	whole = floor(value);
+	sum += frac(value);
+}
+
+float3 blur(sampler2D s, float2 uv, float2 direction)
+{
+	float3 result = 0;
+	[unroll]
+	for (int i = -2; i <= 2; ++i)
+		result += tex2D(s, uv + direction * i * BUFFER_PIXEL_SIZE).rgb * Kernel[i + 2];
+	return result;
+}
+
+float3 tonemap(float3 color, int mode)
+{
+	switch (mode)
+	{
+	case 0:
+		return color;
+	case 1:
+		color = color / (1.0 + color);
+		break;
+	default:
+		color = saturate((color * (2.51 * color + 0.03)) / (color * (2.43 * color + 0.59) + 0.14));
+		break;
+	}
+	return color;
+}
+
+float4 PS_Downsample(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	const Surface s = sample_surface(uv);
+	if (s.is_sky)
+		discard;
+
+	float3 color = blur(BackBuffer, uv, float2(1, 0)) + blur(BackBuffer, uv, float2(0, 1));
+	color *= 0.5;
+
+	float whole = 0, sum = 0;
+	split(Timer * 0.001, whole, sum);
+
+	uint counter = 0;
+	while (counter < Steps && counter < 8u)
+	{
+		counter++;
+		if (counter == 3u)
+			continue;
+		color += (counter & 1u) ? 0.001 : -0.001;
+	}
+
+	int k = 0;
+	do
+	{
+		color.r = max(color.r, Weights[2].x * Kernel[k] * 0.01);
+		k++;
+	} while (k < 3);
+
+	const float2 rotated = mul(Rotation, uv - 0.5) + 0.5;
+	color.gb = lerp(color.gb, rotated, 0.01);
+
+	return float4(color * Tint, sum + whole * 0.0);
+}
+
+float4 PS_Luma(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	const float3 color = tex2Dlod(Intermediate, float4(0.5, 0.5, 0, 1)).rgb;
+	return Helpers::luminance(color);
+}
+
+float4 PS_Combine(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	float4 color = tex2D(BackBuffer, uv);
+	const float luma = tex2Dfetch(Luma, int2(0, 0)).x;
+	const float3 bloom = tex2D(Intermediate, uv).rgb;
+
+	color.rgb = Enabled && Flags.x ? tonemap(color.rgb + bloom * Strength / max(luma, 0.001), Mode) : color.rgb;
+	color.rgb = any(isnan(color.rgb)) ? 0 : color.rgb;
+	color.a = length(float2(ddx(uv.x), ddy(uv.y))) + abs(sin(pos.x)) * step(0.5, cos(pos.y));
+	color.rgb = pow(abs(color.rgb), 1.0 / 2.2) + (float3)int3(Offsets[1], 0) * 0.0;
+	return color;
+}
+
+technique Replay < ui_tooltip = "Record and replay test"; >
+{
+	pass Downsample
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = PS_Downsample;
+		RenderTarget = IntermediateTex;
+		ClearRenderTargets = true;
+	}
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = PS_Luma;
+		RenderTarget0 = LumaTex;
+		BlendEnable = true;
+		BlendOp = ADD;
+		SrcBlend = SRCALPHA;
+		DestBlend = INVSRCALPHA;
+	}
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = PS_Combine;
+		SRGBWriteEnable = true;
+		StencilEnable = true;
+		StencilFunc = ALWAYS;
+		StencilPass = REPLACE;
+		StencilRef = 1;
+	}
+}
+
+technique ReplayDisabled { pass { VertexShader = PostProcessVS; PixelShader = PS_Luma; } }
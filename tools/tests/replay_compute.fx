@@ -0,0 +1,61 @@
+// Compute shaders, storage, shared memory and atomics
+
+uniform uint FrameCount < source = "framecount"; >;
+
+texture2D ResultTex { Width = 64; Height = 64; Format = RGBA8; };
+texture2D CounterTex { Width = 1; Height = 1; Format = R32F; };
+
+sampler2D Result { Texture = ResultTex; };
+storage2D ResultStorage { Texture = ResultTex; };
+storage2D CounterStorage { Texture = CounterTex; };
+
+groupshared uint SharedSum;
+groupshared uint SharedMax;
+groupshared float SharedValues[64];
+
+void CS_Fill(uint3 id : SV_DispatchThreadID, uint3 tid : SV_GroupThreadID, uint index : SV_GroupIndex)
+{
+	if (index == 0)
+	{
+		SharedSum = 0;
+		SharedMax = 0;
+	}
+	barrier();
+
+	SharedValues[index] = float(id.x ^ id.y) / 64.0;
+	atomicAdd(SharedSum, id.x);
+	atomicMax(SharedMax, FrameCount + index);
+	groupMemoryBarrier();
+
+	const float value = SharedValues[63 - index];
+	tex2Dstore(ResultStorage, id.xy, float4(value, float(tid.x) / 8.0, float(SharedSum & 0xFFu) / 255.0, 1.0));
+
+	if (all(id.xy == 0))
+		tex2Dstore(CounterStorage, int2(0, 0), float(SharedMax));
+}
+
+void VS_Full(uint id : SV_VertexID, out float4 pos : SV_Position, out float2 uv : TEXCOORD)
+{
+	uv = float2((id << 1) & 2, id & 2);
+	pos = float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+}
+
+float4 PS_Show(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	return tex2D(Result, uv) * float4(tex2Dsize(Result, 0), 1, 1).zzzw;
+}
+
+technique ReplayCompute
+{
+	pass
+	{
+		ComputeShader = CS_Fill<8, 8>;
+		DispatchSizeX = 8;
+		DispatchSizeY = 8;
+	}
+	pass
+	{
+		VertexShader = VS_Full;
+		PixelShader = PS_Show;
+	}
+}
@@ -0,0 +1,22 @@
+// Scanned with a set of macros defined beforehand, only some of which affect the output
+
+#include "scan.fxh"
+
+#if SCAN_QUALITY > 1
+static const float ScanQuality = 1;
+#endif
+
+#ifdef SCAN_FEATURE
+static const float ScanFeature = 1;
+#endif
+
+#if 0
+static const float ScanSkipped = SCAN_SKIPPED;
+#endif
+
+static const float ScanValue = SCAN_VALUE;
+
+#define SCAN_LOCAL SCAN_INDIRECT
+static const float ScanIndirect = SCAN_LOCAL;
+
+#define SCAN_UNUSED_LOCAL SCAN_UNUSED
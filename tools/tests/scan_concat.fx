@@ -0,0 +1,5 @@
+// Macro names formed by token concatenation are not known without expanding them, so all macros defined beforehand are dependencies
+
+#define SCAN_CAT(a, b) a##b
+
+static const float ScanConcat = SCAN_CAT(SCAN_, VALUE);
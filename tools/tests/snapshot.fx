@@ -0,0 +1,26 @@
+// Includes the same headers several times, both directly and nested, so that include snapshots and the include guard skip are used
+
+#include "ReShade.fxh"
+#include "snapshot.fxh"
+#include "snapshot_guarded.fxh"
+#include "snapshot.fxh"
+
+texture2D BackBufferTex : COLOR;
+sampler2D BackBuffer { Texture = BackBufferTex; };
+
+float4 PS_Snapshot(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	float4 color = 0;
+	[unroll] for (int i = 0; i < SNAPSHOT_SAMPLES; ++i)
+		color += tex2D(BackBuffer, uv + BUFFER_PIXEL_SIZE * i) * SnapshotWeight(i) * GuardedValue;
+	return color;
+}
+
+technique Snapshot
+{
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = PS_Snapshot;
+	}
+}
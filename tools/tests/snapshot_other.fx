@@ -0,0 +1,19 @@
+// Uses a different macro state than 'snapshot.fx' before including the same headers, so that the snapshots recorded for that one must not be reused
+
+#define SNAPSHOT_QUALITY 2
+#include "ReShade.fxh"
+#include "snapshot.fxh"
+
+float4 PS_SnapshotOther(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target
+{
+	return SnapshotWeight(SNAPSHOT_SAMPLES) * GuardedValue;
+}
+
+technique SnapshotOther
+{
+	pass
+	{
+		VertexShader = PostProcessVS;
+		PixelShader = PS_SnapshotOther;
+	}
+}